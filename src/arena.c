@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "tiler.h"
+#include "utils.h"
+#include "arena.h"
+
+/* overflow block, chained until next reset */
+typedef struct Overflow {
+    struct Overflow *next;
+    size_t size;
+} Overflow_t;
+
+static char *block = NULL;
+static size_t used = 0;
+static size_t overflow_used = 0;
+static Overflow_t *overflows = NULL;
+static ArenaStats_t stats;
+
+static size_t
+align(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+/**
+ * Allocate transient memory, valid until next arena_reset()
+ * @return zeroed memory is NOT guaranteed
+ */
+void *
+arena_alloc(size_t size)
+{
+    void *ptr;
+
+    size = align(size);
+    stats.allocations++;
+    stats.bytes += size;
+
+    if(block == NULL) {
+        stats.size = ARENA_INITIAL_SIZE;
+        if((block = malloc(stats.size)) == NULL)
+            FATAL(("Could not allocate arena"));
+        stats.heap_blocks++;
+    }
+
+    if(used + size <= stats.size) {
+        ptr = block + used;
+        used += size;
+        return ptr;
+    }
+
+    /* too big for this action: overflow block until next reset */
+    Overflow_t *o = malloc(align(sizeof(Overflow_t)) + size);
+    if(o == NULL)
+        FATAL(("Could not allocate arena overflow (%zu bytes)", size));
+
+    stats.heap_blocks++;
+    o->size = size;
+    o->next = overflows;
+    overflows = o;
+    overflow_used += size;
+
+    return (char *) o + align(sizeof(Overflow_t));
+}
+
+/**
+ * Release everything allocated since last reset
+ * If the action overflowed, the arena is grown for the next ones.
+ */
+void
+arena_reset()
+{
+    size_t total = used + overflow_used;
+
+    stats.resets++;
+    stats.peak = MAX(stats.peak, total);
+
+    if(overflows != NULL) {
+        while(overflows != NULL) {
+            Overflow_t *next = overflows->next;
+            free(overflows);
+            overflows = next;
+        }
+
+        /* room for the peak, plus some margin */
+        stats.size = align(stats.peak + stats.peak / 2);
+        free(block);
+        if((block = malloc(stats.size)) == NULL)
+            FATAL(("Could not allocate arena"));
+        stats.heap_blocks++;
+    }
+
+    used = 0;
+    overflow_used = 0;
+}
+
+/**
+ * Give the arena memory back (at exit)
+ * @note once the worker is joined, see stop_worker()
+ */
+void
+arena_free()
+{
+    arena_reset();
+    FREE(block);
+    stats.size = 0;
+}
+
+const ArenaStats_t *
+get_arena_stats()
+{
+    return &stats;
+}
+
+/**
+ * Bytes of heap in use, mmapped blocks included
+ * @return 0 if the C library cannot tell (mallinfo2() is glibc 2.33+,
+ * mallinfo() before, wrapping past 4 GB)
+ */
+size_t
+get_heap_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 heap = mallinfo2();
+
+    return heap.uordblks + heap.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo heap = mallinfo();
+
+    return (unsigned int) heap.uordblks + (unsigned int) heap.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Print allocation counters, along with the heap in use
+ * A steady heap over time means no leak on the action path.
+ */
+void
+print_arena_stats()
+{
+    size_t heap = get_heap_in_use();
+
+    printf(COLOR_BOLD"Memory:\n"COLOR_CLEAR
+           "  - arena allocations  %lu (%llu bytes)\n"
+           "  - arena resets       %lu\n"
+           "  - arena size         %zu (peak %zu)\n"
+           "  - arena heap blocks  %lu\n",
+           stats.allocations, stats.bytes, stats.resets,
+           stats.size, stats.peak, stats.heap_blocks);
+
+    if(heap > 0)
+        printf("  - heap in use        %zu bytes\n", heap);
+    else
+        printf("  - heap in use        unknown\n");
+}
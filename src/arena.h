@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "utils.h"
+
+/**
+  @page Arena
+
+  Transient data of an action (window lists, snapshots...) is allocated from
+  a single arena, reset by the worker once the action is done: nothing to
+  free, nothing to leak, and no call to malloc() once the arena has grown to
+  the size needed by the largest action.
+
+  When an action needs more than the arena holds, extra blocks are taken
+  from the heap; on reset, they are released and the arena grows to the
+  peak size observed so far.
+
+  @note the arena belongs to the thread running actions (the main thread
+  at startup, the worker then), stop_worker() frees it once the worker is
+  joined
+  */
+
+#define ARENA_INITIAL_SIZE  (16 * 1024)
+#define ARENA_ALIGN         16
+
+/** allocation counters
+ * @struct ArenaStats_t
+ */
+typedef struct {
+    unsigned long allocations;  /**< arena_alloc() calls */
+    unsigned long long bytes;   /**< bytes handed out */
+    unsigned long resets;       /**< arena_reset() calls */
+    unsigned long heap_blocks;  /**< blocks taken from the heap (growth, overflows) */
+    size_t size;                /**< current size of the main block */
+    size_t peak;                /**< largest amount used by a single action */
+} ArenaStats_t;
+
+void *arena_alloc(size_t);
+void arena_reset();
+void arena_free();
+const ArenaStats_t *get_arena_stats();
+size_t get_heap_in_use();
+void print_arena_stats();
+
+#endif /* ARENA_H */
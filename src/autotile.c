@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "worker.h"
+#include "trace.h"
+#include "keybindings.h"
+#include "rules.h"
+#include "autotile.h"
+
+#define NS_PER_MS 1000000ULL
+
+static Atom client_list_atom = None;
+
+/* debounce timer, event loop only */
+static bool pending = false;
+static unsigned long long first_event = 0, deadline = 0;
+
+static unsigned long nb_events = 0, nb_relayouts = 0;
+
+/**
+ * Start watching windows coming and going on the root window
+ * @note does nothing unless some monitor or desktop is auto-tiled, or
+ * rules are to be applied to new windows
+ */
+void
+init_autotile()
+{
+    if(settings.autotile_monitors == 0 && settings.autotile_desktops == 0 && !has_rules())
+        return;
+
+    client_list_atom = get_atom(event_display, "_NET_CLIENT_LIST");
+
+    /* replaces the mask set by track_active_window(), keeping its events */
+    XCALL(X_ONEWAY, "ChangeWindowAttributes", "SubstructureNotifyMask", XDefaultRootWindow(event_display),
+          XSelectInput(event_display, XDefaultRootWindow(event_display),
+                       ROOT_EVENT_MASK | SubstructureNotifyMask));
+}
+
+/**
+ * Whether windows of a monitor, on a desktop, are auto-tiled
+ */
+bool
+autotile_enabled(int monitor, int desktop)
+{
+    return (monitor >= 0 && monitor < 32 && (settings.autotile_monitors & (1U << monitor)))
+           || (desktop >= 0 && desktop < 32 && (settings.autotile_desktops & (1U << desktop)));
+}
+
+/**
+ * (Re)arm the relayout timer on windows appearing or disappearing
+ * Menus and tooltips (override-redirect) are not managed and ignored.
+ */
+void
+autotile_event(XEvent *event)
+{
+    unsigned long long now, max_deadline;
+
+    if(client_list_atom == None)
+        return;
+
+    switch(event->type) {
+    case MapNotify:
+        if(event->xmap.override_redirect)
+            return;
+        break;
+    case UnmapNotify:
+    case DestroyNotify:
+        break;
+    case PropertyNotify:
+        if(event->xproperty.atom != client_list_atom)
+            return;
+        break;
+    default:
+        return;
+    }
+
+    now = trace_now();
+    nb_events++;
+
+    if(!pending) {
+        pending = true;
+        first_event = now;
+    }
+
+    deadline = now + settings.autotile_delay * NS_PER_MS;
+    max_deadline = first_event + AUTOTILE_MAX_DELAYS * settings.autotile_delay * NS_PER_MS;
+    if(deadline > max_deadline)
+        deadline = max_deadline;
+}
+
+/**
+ * Time left before the pending relayout, to be used as poll() timeout
+ * @return milliseconds, -1 if no relayout is pending
+ */
+int
+autotile_timeout()
+{
+    unsigned long long now;
+
+    if(!pending)
+        return -1;
+
+    now = trace_now();
+    if(now >= deadline)
+        return 0;
+
+    return (deadline - now + NS_PER_MS - 1) / NS_PER_MS;
+}
+
+/**
+ * Queue the relayout once the storm is over
+ */
+void
+autotile_flush()
+{
+    if(!pending || trace_now() < deadline)
+        return;
+
+    pending = false;
+    nb_relayouts++;
+    queue_action(RELAYOUT, None);
+}
+
+/**
+ * Print how many events were absorbed by the debounce timer
+ * @ingroup debug
+ */
+void
+print_autotile_stats()
+{
+    if(client_list_atom == None)
+        return;
+
+    INFO(("auto-tiling: %lu events, %lu relayouts", nb_events, nb_relayouts));
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef AUTOTILE_H
+#define AUTOTILE_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Autotile
+
+  Auto-tiling (<code>autotile</code> in the configuration file): windows of
+  the chosen monitors or desktops are tiled as soon as they appear or go away.
+
+  @li the event loop watches MapNotify/UnmapNotify/DestroyNotify on the root
+      window and changes of <code>_NET_CLIENT_LIST</code>
+  @li events only arm a timer: a relayout is queued once nothing happened for
+      <code>autotile_delay</code> ms, so that a storm of windows (an IDE
+      opening all its tool windows) costs a single relayout. The timer is
+      not pushed back beyond AUTOTILE_MAX_DELAYS delays under a steady flow
+  @li the relayout itself, relayout(), runs on the worker: it applies
+      @ref Rules to new windows and only moves the windows whose tile changed
+
+  @code
+  autotile = monitor:0,desktop:2
+  autotile_delay = 150
+  @endcode
+  */
+
+/** a storm is cut after that many debounce delays */
+#define AUTOTILE_MAX_DELAYS 8
+
+void init_autotile();
+bool autotile_enabled(int, int);
+void autotile_event(XEvent *);
+int  autotile_timeout();
+void autotile_flush();
+void print_autotile_stats();
+
+#endif /* AUTOTILE_H */
@@ -15,6 +15,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "tiler.h"
 #include "config.h"
@@ -22,8 +23,54 @@
 #include "keybindings.h"
 #include "geometries.h"
 #include "xactions.h"
+#include "worker.h"
+#include "clients.h"
+#include "arena.h"
+#include "trace.h"
+#include "autotile.h"
+#include "layout.h"
+#include "rules.h"
+#include "splits.h"
+#include "neighbours.h"
+#include "ipc.h"
 #include "callbacks.h"
 
+/**
+ * X requests budgets, indexed by binding
+ * Fixed parts include interning the atoms used, on first call.
+ * @see Budget_t, check_budget
+ */
+const Budget_t budgets[MOVESLEN] = {
+    /* roundtrips, per window, requests, per window */
+    [TOP]         = { 8, 0, 12, 0},
+    [TOPRIGHT]    = { 8, 0, 12, 0},
+    [TOPLEFT]     = { 8, 0, 12, 0},
+    [BOTTOM]      = { 8, 0, 12, 0},
+    [BOTTOMRIGHT] = { 8, 0, 12, 0},
+    [BOTTOMLEFT]  = { 8, 0, 12, 0},
+    [RIGHT]       = { 8, 0, 12, 0},
+    [LEFT]        = { 8, 0, 12, 0},
+    [LEFTSCREEN]  = {10, 0, 14, 0},
+    [RIGHTSCREEN] = {10, 0, 14, 0},
+    [GRID]        = {24, 5, 32, 5},
+    [SIDEBYSIDE]  = {24, 5, 32, 5},
+    [MAXIMIZE]    = { 8, 0, 10, 0},
+    [LISTWINDOWS] = {16, 24, 16, 24}, /* debug only */
+    [RELAYOUT]    = { 8, 9, 12, 11},  /* per window: first sight, rules, hints, class, move */
+    [SAVELAYOUT]  = { 8, 9, 12, 9},   /* per window: first sight, class, role, geometry */
+    [RESTORELAYOUT] = { 8, 8, 12, 11}, /* per window: first sight, class, role, move, desktop */
+    [GROWSPLIT]   = { 4, 1, 6, 4},    /* per window moved: class, move */
+    [SHRINKSPLIT] = { 4, 1, 6, 4},
+    [FOCUSLEFT]   = { 8, 5, 10, 6},   /* per window first seen: desktop, types, states, geometry */
+    [FOCUSRIGHT]  = { 8, 5, 10, 6},
+    [FOCUSUP]     = { 8, 5, 10, 6},
+    [FOCUSDOWN]   = { 8, 5, 10, 6},
+    [SWAPLEFT]    = {10, 5, 16, 6},   /* same, plus two windows moved */
+    [SWAPRIGHT]   = {10, 5, 16, 6},
+    [SWAPUP]      = {10, 5, 16, 6},
+    [SWAPDOWN]    = {10, 5, 16, 6},
+};
+
 /**
  * @brief Dummy function for test purpose
  *
@@ -36,6 +83,60 @@ dummy(void *data)
     D(("*** dummy ***"));
 }
 
+/**
+ * Window the current action applies to
+ * The event loop already knows the active window, avoid asking again.
+ */
+static Window
+target_window()
+{
+    const Action_t *action = get_current_action();
+
+    if(action->target != None)
+        return action->target;
+
+    return get_active_window();
+}
+
+/**
+ * Tell socket subscribers where a window has been placed
+ */
+static void
+announce(Window win, const Client_t *client)
+{
+    ipc_publish("placed 0x%lx %d %s\n", win, client->monitor,
+                client->zone < MOVESLEN ? bindings_reference[client->zone].name : "none");
+}
+
+/**
+ * Remember where a window has been placed
+ */
+static void
+remember(Window win, int monitor, Move_t zone, int ratio, Geometry_t geometry)
+{
+    Client_t *client = add_client(win);
+
+    client->zone = zone;
+    client->monitor = monitor;
+    client->ratio = ratio;
+    client->geometry = geometry;
+    announce(win, client);
+}
+
+/**
+ * Move a window into a zone and remember it
+ */
+static void
+place(Window win, int monitor, Move_t zone, int ratio)
+{
+    Geometry_t geometry;
+
+    get_zone_geometry(monitor, zone, ratio, &geometry);
+    fill_geometry(display, win, geometry);
+    remember(win, monitor, zone, ratio, geometry);
+    forget_split(win);
+}
+
 /**
  * @brief Organize windows in current desktop on a grid
  *
@@ -50,14 +151,17 @@ dummy(void *data)
 void
 grid(void *data)
 {
-    Window *window_list = NULL;
-    int size = -1, monitor = -1;
+    Window *window_list = NULL, placed[4];
+    Geometry_t tiles[4];
+    SizeHints_t hints[4];
+    Move_t zones[4];
+    int size = -1, i, monitor = get_current_action()->monitor;
 
-    size = list_windows(display, root, &window_list, LIST_DEFAULT);
-    monitor = get_window_monitor(get_active_window());
+    size = list_top_windows(display, root, &window_list, LIST_DEFAULT, 4);
     D(("Nb windows on desktop : %d", size));
 
-    if(window_list == NULL)
+    /* superseded while listing windows */
+    if(window_list == NULL || action_cancelled())
         return;
 
     /* single window on desktop */
@@ -66,34 +170,19 @@ grid(void *data)
         return;
     }
 
-    /* two windows on desktop, youhou party time \o/ */
-    if(size == 2) {
-        sidebyside(NULL);
-        return;
-    }
-
-    /* three windows on desktop */
-    if(size == 3) {
-        Geometry_t left        = * (Geometry_t *) bindings[monitor][LEFT].data;
-        Geometry_t topright    = * (Geometry_t *) bindings[monitor][TOPRIGHT].data;
-        Geometry_t bottomright = * (Geometry_t *) bindings[monitor][BOTTOMRIGHT].data;
-
-        fill_geometry(display, window_list[size-1], left);
-        fill_geometry(display, window_list[size-2], topright);
-        fill_geometry(display, window_list[size-3], bottomright);
-        return;
+    plan_grid(monitor, size, tiles, zones);
+    for(i = 0; i < size; i++) {
+        placed[i] = window_list[size-1-i];
+        hints[i] = *get_client_hints(display, add_client(placed[i]));
     }
+    build_split_tree(get_current_desktop(display), monitor, placed, tiles, size);
+    solve_hints(size, hints, tiles);
 
-    /* stop at 4 win on squared grid for now */
-    Geometry_t topleft     = * (Geometry_t *) bindings[monitor][TOPLEFT].data;
-    Geometry_t topright    = * (Geometry_t *) bindings[monitor][TOPRIGHT].data;
-    Geometry_t bottomleft  = * (Geometry_t *) bindings[monitor][BOTTOMLEFT].data;
-    Geometry_t bottomright = * (Geometry_t *) bindings[monitor][BOTTOMRIGHT].data;
+    for(i = 0; i < size; i++)
+        remember(placed[i], monitor, zones[i], 0, tiles[i]);
 
-    fill_geometry(display, window_list[size-1], topleft);
-    fill_geometry(display, window_list[size-2], topright);
-    fill_geometry(display, window_list[size-3], bottomleft);
-    fill_geometry(display, window_list[size-4], bottomright);
+    /* one batch, paced as a whole */
+    fill_geometries(display, placed, tiles, size);
 }
 
 /**
@@ -103,24 +192,36 @@ grid(void *data)
 void
 sidebyside(void *data)
 {
-    Window *window_list = NULL;
-    int size = -1, monitor = -1;
+    Window *window_list = NULL, placed[2];
+    Geometry_t tiles[2];
+    SizeHints_t hints[2];
+    int size = -1, monitor = get_current_action()->monitor;
 
-    size = list_windows(display, root, &window_list, LIST_DEFAULT);
-    monitor = get_window_monitor(get_active_window());
+    size = list_top_windows(display, root, &window_list, LIST_DEFAULT, 2);
 
-    if(size < 2 || window_list == NULL)
+    if(size < 2 || window_list == NULL || action_cancelled())
         return;
 
-    Geometry_t left  = * (Geometry_t *) bindings[monitor][LEFT].data;
-    Geometry_t right = * (Geometry_t *) bindings[monitor][RIGHT].data;
+    placed[0] = window_list[size-1];
+    placed[1] = window_list[size-2];
+    get_zone_geometry(monitor, LEFT, 0, &tiles[0]);
+    get_zone_geometry(monitor, RIGHT, 0, &tiles[1]);
+    hints[0] = *get_client_hints(display, add_client(placed[0]));
+    hints[1] = *get_client_hints(display, add_client(placed[1]));
+    build_split_tree(get_current_desktop(display), monitor, placed, tiles, 2);
+    solve_hints(2, hints, tiles);
+    remember(placed[0], monitor, LEFT, 0, tiles[0]);
+    remember(placed[1], monitor, RIGHT, 0, tiles[1]);
 
-    fill_geometry(display, window_list[size-1], left);
-    fill_geometry(display, window_list[size-2], right);
+    fill_geometries(display, placed, tiles, 2);
 }
 
 /**
  * @brief Standard move window function
+ *
+ * Pressing again the same binding on a window cycles the size of the zone
+ * (1/2, 1/3, 2/3 of the screen), tiler remembering where it put the window.
+ *
  * @param[in] data
  *  Geometry_t structure representing the desired shape for the active window
  * @todo rename
@@ -133,8 +234,17 @@ move(void *data)
         return;
     }
 
-    Geometry_t geometry = * (Geometry_t *) data;
-    fill_geometry(display, get_active_window(display), geometry);
+    const Action_t *action = get_current_action();
+    Window win = target_window();
+    Client_t *client = get_client(win);
+    int presses = MAX(action->presses, 1);
+    int ratio = (presses - 1) % NB_ZONE_RATIOS;
+
+    /* coalesced presses cycle as many times */
+    if(client != NULL && client->zone == action->move && client->monitor == action->monitor)
+        ratio = (client->ratio + presses) % NB_ZONE_RATIOS;
+
+    place(win, action->monitor, action->move, ratio);
 }
 
 
@@ -146,11 +256,24 @@ move(void *data)
 void
 maximize(void *data)
 {
-    maximize_window(display, get_active_window());
+    Window win = target_window();
+    Client_t *client = add_client(win);
+
+    maximize_window(display, win);
+
+    client->zone = MAXIMIZE;
+    client->monitor = get_current_action()->monitor;
+    client->ratio = 0;
+    announce(win, client);
 }
 
 /**
  * move window from one screen to another
+ *
+ * Windows placed by tiler keep their zone (and size step) on the target
+ * monitor without any request to the server. Other windows are matched
+ * against known zones from their actual geometry, or simply translated.
+ *
  * @param[in] data target monitor
  * @since 0.2
  * @see compute_geometries_for_monitor
@@ -162,23 +285,47 @@ changescreen(void *data)
         return;
 
     Monitor_t monitor = * (Monitor_t *) data;
-    Window win = get_active_window(display);
-    Geometry_t current_position, new_position, current_position_abs;
+    Window win = target_window();
+    Client_t *client = get_client(win);
+    Geometry_t current_position, new_position;
     Move_t move;
-    get_window_relative_geometry(display, win, &current_position);
-    get_window_geometry(display, win, &current_position_abs);
-    new_position = current_position;
+    int current_monitor;
 
-    if((move = get_current_move(get_window_monitor(win), current_position_abs)) != MOVESLEN){
-        new_position = * (Geometry_t *) bindings[monitor.id][move].data;
-    }else{
-        /* simple version without size checks */
-        new_position.x = current_position.x + monitor.workarea.x;
-        new_position.y = current_position.y + monitor.workarea.y;
+    if(client != NULL && client->zone != MOVESLEN) {
+        if(client->zone == MAXIMIZE) {
+            get_zone_geometry(monitor.id, MAXIMIZE, 0, &new_position);
+            fill_geometry(display, win, new_position);
+            maximize_window(display, win);
+            client->monitor = monitor.id;
+            client->geometry = new_position;
+            announce(win, client);
+        } else {
+            place(win, monitor.id, client->zone, client->ratio);
+        }
+        return;
     }
+
+    /* fallback: guess from the window geometry */
+    get_window_geometry(display, win, &current_position);
+    current_monitor = get_geometry_monitor(current_position);
+
+    if((move = get_current_move(current_monitor, current_position)) != MOVESLEN) {
+        place(win, monitor.id, move, 0);
+        return;
+    }
+
+    /* simple version without size checks */
+    new_position = current_position;
+    new_position.x = current_position.x - settings.monitors[current_monitor].workarea.x + monitor.workarea.x;
+    new_position.y = current_position.y - settings.monitors[current_monitor].workarea.y + monitor.workarea.y;
+
     D(("(%d, %d) => (%d, %d) [%d, %d]", current_position.x, current_position.y, new_position.x, new_position.y, monitor.workarea.x, monitor.workarea.y))
 
     fill_geometry(display, win, new_position);
+
+    client = add_client(win);
+    client->monitor = monitor.id;
+    client->geometry = new_position;
 }
 
 
@@ -203,3 +350,391 @@ listwindows(void *data)
         print_window(display, window_list[i]);
     }
 }
+
+
+/**
+ * Apply the first matching rule to a window seen for the first time
+ * A window given a zone or ignored is left out of auto-tiling and grid().
+ * @see @ref Rules
+ */
+static void
+apply_rules(Window win, Client_t *client)
+{
+    ClientState_t *state = add_state(win);
+    const Rule_t *rule = match_rules(display, win, client);
+
+    /* once: the outcome is kept with the state, whatever the client table evicts */
+    state->ruled = true;
+    if(rule == NULL)
+        return;
+
+    if(rule->monitor >= 0 && rule->monitor < settings.nb_monitors)
+        client->monitor = state->monitor = rule->monitor;
+
+    state->ignored = rule->ignore || rule->zone != MOVESLEN;
+
+    if(rule->zone == MAXIMIZE) {
+        maximize_window(display, win);
+        client->zone = MAXIMIZE;
+        announce(win, client);
+    } else if(rule->zone != MOVESLEN) {
+        place(win, MAX(client->monitor, 0), rule->zone, 0);
+    }
+}
+
+/** auto-tiled window, with its order of arrival */
+typedef struct {
+    Window window;
+    unsigned long order;
+} Tiled_t;
+
+/** Order of arrival of auto-tiled windows */
+static int
+compare_tile_order(const void *a, const void *b)
+{
+    const Tiled_t *ta = (const Tiled_t *) a, *tb = (const Tiled_t *) b;
+
+    return (ta->order > tb->order) - (ta->order < tb->order);
+}
+
+/**
+ * @brief Tile windows of auto-tiled monitors on the current desktop
+ *
+ * Windows keep their order of arrival, a new window takes the last tile.
+ * Only windows whose tile changed are moved, and only windows never seen
+ * before are queried: beyond reading the client list, the cost depends on
+ * what changed rather than on the number of windows.
+ *
+ * Windows seen for the first time go through @ref Rules beforehand.
+ *
+ * Windows are kept by id and looked up again when used: the client table
+ * may evict a record, and reuse its slot, while others are added.
+ *
+ * Queued by the event loop when windows are mapped or unmapped
+ * (see @ref Autotile), and available as a binding to force a relayout.
+ *
+ * @param[in] data (unused)
+ * @todo windows sent to another desktop or monitor by the WM are not noticed
+ */
+void
+relayout(void *data)
+{
+    static unsigned long last_order = 0;
+    Window *window_list = NULL, *candidates, *moved;
+    Tiled_t *tiled;
+    Client_t *client;
+    ClientState_t *state;
+    Geometry_t *tiles, *geometries;
+    SizeHints_t *hints;
+    int *monitors;
+    int size, desktop, monitor, i, count, nb_candidates = 0, nb_moved;
+
+    size = get_client_list(display, root, &window_list);
+    desktop = get_current_desktop(display);
+
+    if(size == 0)
+        return;
+
+    candidates = (Window *) arena_alloc(size * sizeof(Window));
+    monitors = (int *) arena_alloc(size * sizeof(int));
+    tiled = (Tiled_t *) arena_alloc(size * sizeof(Tiled_t));
+    tiles = (Geometry_t *) arena_alloc(size * sizeof(Geometry_t));
+    geometries = (Geometry_t *) arena_alloc(size * sizeof(Geometry_t));
+    hints = (SizeHints_t *) arena_alloc(size * sizeof(SizeHints_t));
+    moved = (Window *) arena_alloc(size * sizeof(Window));
+
+    for(i = 0; i < size && !action_cancelled(); i++) {
+        state = get_state(window_list[i]);
+
+        client = update_client(display, window_list[i]);
+        if(state == NULL || !state->ruled)
+            apply_rules(window_list[i], client);
+
+        if(client->regular && !is_ignored(window_list[i]) && client->desktop == desktop) {
+            candidates[nb_candidates] = window_list[i];
+            monitors[nb_candidates++] = client->monitor;
+        }
+    }
+
+    for(monitor = 0; monitor < settings.nb_monitors && !action_cancelled(); monitor++) {
+        if(!autotile_enabled(monitor, desktop))
+            continue;
+
+        for(count = 0, i = 0; i < nb_candidates; i++) {
+            if(monitors[i] != monitor)
+                continue;
+            state = add_state(candidates[i]);
+            if(state->tile_order == 0)
+                state->tile_order = ++last_order;
+            tiled[count].window = candidates[i];
+            tiled[count++].order = state->tile_order;
+        }
+
+        if(count == 0)
+            continue;
+
+        qsort(tiled, count, sizeof(Tiled_t), compare_tile_order);
+        plan_grid(monitor, count, tiles, NULL);
+
+        for(i = 0; i < count; i++) {
+            hints[i] = *get_client_hints(display, add_client(tiled[i].window));
+            moved[i] = tiled[i].window;
+        }
+        build_split_tree(desktop, monitor, moved, tiles, count);
+        solve_hints(count, hints, tiles);
+
+        for(nb_moved = 0, i = 0; i < count; i++) {
+            client = add_client(tiled[i].window);
+            if(memcmp(&client->geometry, &tiles[i], sizeof(Geometry_t)) == 0)
+                continue;
+
+            moved[nb_moved] = tiled[i].window;
+            geometries[nb_moved++] = tiles[i];
+        }
+
+        /* only windows actually sent count as placed: if superseded, the
+         * next relayout moves the others */
+        nb_moved = fill_geometries(display, moved, geometries, nb_moved);
+        D(("relayout of monitor %d: %d windows, %d moved", monitor, count, nb_moved));
+
+        for(i = 0; i < nb_moved; i++) {
+            client = add_client(moved[i]);
+            client->geometry = geometries[i];
+            client->zone = MOVESLEN;
+            client->ratio = 0;
+        }
+    }
+}
+
+
+/** Key of a window in layout snapshots: "instance.class/role"
+ * @return false if the window has no class (not worth saving)
+ */
+static bool
+layout_key(Window win, char *key)
+{
+    char instance[LAYOUT_KEY_LEN / 3 - 1], class[LAYOUT_KEY_LEN / 3 - 1], role[LAYOUT_KEY_LEN / 3 - 1];
+
+    if(!get_window_class(display, win, instance, class, sizeof(class)))
+        return false;
+    get_window_string(display, win, "WM_WINDOW_ROLE", role, sizeof(role));
+
+    snprintf(key, LAYOUT_KEY_LEN, "%s.%s/%s", instance, class, role);
+    return true;
+}
+
+/**
+ * @brief Save where every window is, to be restored with restorelayout()
+ *
+ * Windows placed by tiler are saved with their zone, others with their
+ * actual geometry.
+ *
+ * @param[in] data (unused)
+ * @see @ref Layout
+ */
+void
+savelayout(void *data)
+{
+    Window *window_list = NULL;
+    LayoutEntry_t *saved;
+    Client_t *client;
+    int size, i, count = 0;
+
+    size = get_client_list(display, root, &window_list);
+    saved = (LayoutEntry_t *) arena_alloc(MAX(size, 1) * sizeof(LayoutEntry_t));
+
+    for(i = 0; i < size; i++) {
+        if(action_cancelled())
+            return;
+
+        client = update_client(display, window_list[i]);
+        if(!client->regular)
+            continue;
+
+        memset(&saved[count], 0, sizeof(LayoutEntry_t));
+        if(!layout_key(window_list[i], saved[count].key))
+            continue;
+
+        saved[count].desktop = client->desktop;
+        saved[count].monitor = MAX(client->monitor, 0);
+        saved[count].zone = client->zone;
+        saved[count].ratio = client->ratio;
+
+        if(client->zone == MOVESLEN) {
+            if(client->geometry.width > 0)
+                saved[count].geometry = client->geometry;
+            else
+                get_window_geometry(display, window_list[i], &saved[count].geometry);
+        }
+
+        count++;
+    }
+
+    if(write_layout(saved, count))
+        INFO(("layout of %d windows saved to \"%s\"", count, settings.layout_file));
+}
+
+/**
+ * @brief Put windows back where savelayout() found them
+ *
+ * Live windows are matched by key through the hash index of the mapped
+ * snapshot, then all of them are moved in a single batch.
+ *
+ * @param[in] data (unused)
+ * @see @ref Layout
+ */
+void
+restorelayout(void *data)
+{
+    Window *window_list = NULL, *moved;
+    Geometry_t *geometries;
+    Move_t *zones;
+    const LayoutEntry_t *entry;
+    Client_t *client;
+    unsigned char *used;
+    char key[LAYOUT_KEY_LEN];
+    int size, i, monitor, nb_moved = 0;
+
+    if(layout_size() == 0)
+        return;
+
+    size = get_client_list(display, root, &window_list);
+    used = (unsigned char *) arena_alloc(layout_size());
+    moved = (Window *) arena_alloc(MAX(size, 1) * sizeof(Window));
+    geometries = (Geometry_t *) arena_alloc(MAX(size, 1) * sizeof(Geometry_t));
+    zones = (Move_t *) arena_alloc(MAX(size, 1) * sizeof(Move_t));
+    memset(used, 0, layout_size());
+
+    for(i = 0; i < size && !action_cancelled(); i++) {
+        client = update_client(display, window_list[i]);
+        if(!client->regular || !layout_key(window_list[i], key))
+            continue;
+
+        if((entry = match_layout(key, used)) == NULL)
+            continue;
+
+        /* monitors may have changed since */
+        monitor = (entry->monitor < settings.nb_monitors) ? entry->monitor : 0;
+
+        if(entry->desktop != client->desktop) {
+            set_window_desktop(display, window_list[i], entry->desktop);
+            client->desktop = entry->desktop;
+        }
+
+        if(entry->zone < MOVESLEN)
+            get_zone_geometry(monitor, entry->zone, entry->ratio, &geometries[nb_moved]);
+        else
+            geometries[nb_moved] = entry->geometry;
+
+        zones[nb_moved] = entry->zone;
+        moved[nb_moved++] = window_list[i];
+
+        client->zone = entry->zone;
+        client->ratio = entry->ratio;
+        client->monitor = monitor;
+        client->geometry = geometries[nb_moved-1];
+        announce(window_list[i], client);
+    }
+
+    fill_geometries(display, moved, geometries, nb_moved);
+
+    /* after the move, or it would unmaximize them; their clients may be evicted by now */
+    for(i = 0; i < nb_moved; i++) {
+        if(zones[i] == MAXIMIZE)
+            maximize_window(display, moved[i]);
+    }
+
+    INFO(("%d windows restored from \"%s\"", nb_moved, settings.layout_file));
+}
+
+/**
+ * @brief Grow (growsplit) or shrink (shrinksplit) the active window in its
+ * split, as laid out by the last grid or relayout
+ *
+ * Only the windows under the split are moved, in one batch. Repeated
+ * presses are coalesced into a number of steps.
+ *
+ * @param[in] data (unused)
+ * @see Splits
+ */
+void
+resizesplit(void *data)
+{
+    Window *windows = (Window *) arena_alloc(SPLIT_NODES_LEN * sizeof(Window));
+    Geometry_t *geometries = (Geometry_t *) arena_alloc(SPLIT_NODES_LEN * sizeof(Geometry_t));
+    Client_t *client;
+    int i, n;
+
+    n = resize_split(target_window(), get_current_action()->steps, windows, geometries);
+    trace_windows(n);
+
+    for(i = 0; i < n; i++) {
+        client = add_client(windows[i]);
+        client->geometry = geometries[i];
+        client->zone = MOVESLEN;
+        client->ratio = 0;
+    }
+
+    fill_geometries(display, windows, geometries, n);
+}
+
+/** Direction of focusleft...focusdown and swapleft...swapdown, as a zone */
+static Move_t
+direction(Move_t move)
+{
+    static const Move_t directions[] = {LEFT, RIGHT, TOP, BOTTOM};
+
+    return directions[(move - FOCUSLEFT) % 4];
+}
+
+/**
+ * @brief Focus the closest window in a direction (focusleft, focusright,
+ * focusup, focusdown)
+ *
+ * @param[in] data (unused)
+ * @see Neighbours
+ */
+void
+focus(void *data)
+{
+    Window win = target_window();
+    Window next = find_neighbour(display, win, direction(get_current_action()->move));
+
+    if(next != None)
+        activate_window(display, next, win);
+}
+
+/**
+ * @brief Swap the active window with the closest window in a direction
+ * (swapleft, swapright, swapup, swapdown)
+ *
+ * Both windows are moved in one batch, and exchange what tiler remembers
+ * of them: zones, and leaves in their split trees.
+ *
+ * @param[in] data (unused)
+ * @see Neighbours
+ */
+void
+swap(void *data)
+{
+    Window windows[2];
+    Geometry_t geometries[2];
+    Client_t *a, *b, saved;
+
+    windows[0] = target_window();
+    windows[1] = find_neighbour(display, windows[0], direction(get_current_action()->move));
+
+    if(windows[1] == None
+            || (a = get_client(windows[0])) == NULL || (b = get_client(windows[1])) == NULL)
+        return;
+
+    geometries[0] = b->seen;
+    geometries[1] = a->seen;
+
+    saved = *a;
+    remember(windows[0], b->monitor, b->zone, b->ratio, geometries[0]);
+    remember(windows[1], saved.monitor, saved.zone, saved.ratio, geometries[1]);
+    swap_splits(windows[0], windows[1]);
+
+    fill_geometries(display, windows, geometries, 2);
+}
@@ -38,8 +38,33 @@
   @li changescreen()
   @li maximize()
   @li listwindows()
+  @li relayout()
+  @li savelayout()
+  @li restorelayout()
+  @li resizesplit()
+  @li focus()
+  @li swap()
+
+  Callbacks run on the hot path, between a keypress and the window moving on
+  screen. Each of them declares a budget of X requests, as a fixed part plus
+  a part per client window scanned, checked after every action
+  (see check_budget()). Building with <code>-DSTRICT_BUDGETS</code> makes
+  any overrun fatal, so that a change adding round trips is caught as soon
+  as the action is exercised.
   */
 
+/** X requests allowed to a callback
+ * @struct Budget_t
+ */
+typedef struct {
+    int roundtrips;             /**< fixed number of round trips */
+    int roundtrips_per_window;  /**< round trips per client window scanned */
+    int requests;               /**< fixed number of requests (round trips + one-way) */
+    int requests_per_window;    /**< requests per client window scanned */
+} Budget_t;
+
+extern const Budget_t budgets[MOVESLEN];
+
 
 void dummy(void *);
 
@@ -55,4 +80,16 @@ void maximize(void *);
 
 void listwindows(void *);
 
+void relayout(void *);
+
+void savelayout(void *);
+
+void restorelayout(void *);
+
+void resizesplit(void *);
+
+void focus(void *);
+
+void swap(void *);
+
 #endif /* CALLBACKS_H */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "clients.h"
+
+static Client_t clients[CLIENTS_LEN];
+static unsigned long last_stamp = 0;
+
+/* chained, so that states never move */
+static ClientState_t *states[STATES_BUCKETS];
+
+/* window ids are mostly sequential within a client, spread them a bit */
+static unsigned int
+slot(Window window)
+{
+    return (unsigned int)((window * 2654435761UL) >> 8) % CLIENTS_LEN;
+}
+
+/**
+ * Find the record of a window
+ * @return NULL if tiler never placed this window (or forgot about it)
+ */
+Client_t *
+get_client(Window window)
+{
+    unsigned int s = slot(window);
+    int i;
+
+    if(window == None)
+        return NULL;
+
+    for(i = 0; i < CLIENTS_PROBE; i++) {
+        Client_t *c = &clients[(s + i) % CLIENTS_LEN];
+        if(c->window == window) {
+            c->stamp = ++last_stamp;
+            return c;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Find the record of a window, create it if needed
+ * A new record has no zone (MOVESLEN) and may replace the least recently
+ * used record of its neighbourhood.
+ */
+Client_t *
+add_client(Window window)
+{
+    unsigned int s = slot(window);
+    Client_t *c, *victim = NULL;
+    int i;
+
+    if((c = get_client(window)) != NULL)
+        return c;
+
+    for(i = 0; i < CLIENTS_PROBE; i++) {
+        c = &clients[(s + i) % CLIENTS_LEN];
+        if(c->window == None) {
+            victim = c;
+            break;
+        }
+        if(victim == NULL || c->stamp < victim->stamp)
+            victim = c;
+    }
+
+    memset(victim, 0, sizeof(Client_t));
+    victim->window  = window;
+    victim->zone    = MOVESLEN;
+    victim->monitor = -1;
+    victim->desktop = -1;
+    victim->stamp   = ++last_stamp;
+
+    return victim;
+}
+
+/**
+ * Drop the record and the state of a window (if any)
+ */
+void
+forget_client(Window window)
+{
+    ClientState_t **link = &states[slot(window) % STATES_BUCKETS], *state;
+    Client_t *c = get_client(window);
+
+    if(c != NULL)
+        c->window = None;
+
+    for(; *link != NULL; link = &(*link)->next) {
+        if((*link)->window == window) {
+            state = *link;
+            *link = state->next;
+            free(state);
+            return;
+        }
+    }
+}
+
+/**
+ * Record in a slot of the table, to go through all of them
+ * @return a record with window None if the slot is free
+ */
+const Client_t *
+get_client_slot(int i)
+{
+    return &clients[i];
+}
+
+/**
+ * Find the state of a window
+ * @return NULL if nothing was kept about this window
+ */
+ClientState_t *
+get_state(Window window)
+{
+    ClientState_t *state;
+
+    if(window == None)
+        return NULL;
+
+    for(state = states[slot(window) % STATES_BUCKETS]; state != NULL; state = state->next) {
+        if(state->window == window)
+            return state;
+    }
+
+    return NULL;
+}
+
+/**
+ * Find the state of a window, create it if needed
+ * @note the window has to be watched, for the state to be dropped on DestroyNotify
+ */
+ClientState_t *
+add_state(Window window)
+{
+    ClientState_t *state;
+    unsigned int s = slot(window) % STATES_BUCKETS;
+
+    if((state = get_state(window)) != NULL)
+        return state;
+
+    if((state = (ClientState_t *) calloc(1, sizeof(ClientState_t))) == NULL)
+        FATAL(("Could not allocate client state"));
+
+    state->window = window;
+    state->monitor = -1;
+    state->correction = -1;
+    state->next = states[s];
+    states[s] = state;
+
+    return state;
+}
+
+/**
+ * Whether a rule leaves the window alone: never tiled
+ */
+bool
+is_ignored(Window window)
+{
+    ClientState_t *state = get_state(window);
+
+    return state != NULL && state->ignored;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CLIENTS_H
+#define CLIENTS_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Clients
+
+  Tiler remembers what it did to each window it placed, so that following
+  actions do not have to guess it back from the window geometry (which the
+  WM is free to adjust) with a bunch of round trips.
+
+  Records are kept in a fixed size table indexed by window id. Each window
+  can only live in a small neighbourhood of slots: lookups stay O(1) and the
+  least recently used record of the neighbourhood is evicted when it is full,
+  no need to track destroyed windows (those the worker watches are
+  forgotten anyway, see drain_client_events()).
+
+  Records also cache a few properties of the windows (desktop, types) so that
+  auto-tiling only queries windows it never saw.
+
+  What cannot be fetched again once evicted (the outcome of @ref Rules, the
+  order of arrival in auto-tiling, the leaf in @ref Splits, the correction
+  being learned) is kept apart in ClientState_t records instead. Those are
+  never evicted: they are dropped when the window is destroyed, every window
+  with a state being watched by the worker.
+
+  @note the table belongs to the worker thread
+  */
+
+#define CLIENTS_LEN     256
+#define CLIENTS_PROBE   8
+
+/** remembered state of a window
+ * @struct Client_t
+ */
+typedef struct {
+    Window window;          /**< window id, None for a free slot */
+    Move_t zone;            /**< zone tiler last placed the window in, MOVESLEN if none */
+    int monitor;            /**< monitor tiler last placed the window on */
+    int ratio;              /**< size step of the zone, cycled by repeated presses @see get_zone_geometry */
+    Geometry_t geometry;    /**< geometry tiler last asked for (width 0 if none) */
+    Geometry_t seen;        /**< where the window was last asked for or seen at (width 0 if unknown) @see Neighbours */
+    bool known;             /**< following properties have been fetched @see update_client */
+    int desktop;            /**< desktop of the window */
+    unsigned int types;     /**< get_window_types() */
+    unsigned int states;    /**< get_window_states() */
+    bool regular;           /**< is_regular() */
+    bool watched;           /**< events selected on the worker's connection @see watch_client */
+    bool hints_known;       /**< hints have been fetched @see get_client_hints */
+    SizeHints_t hints;      /**< size hints of the window */
+    bool sync_checked;      /**< following sync fields have been fetched @see pace_geometries */
+    XID sync_counter;       /**< <code>_NET_WM_SYNC_REQUEST_COUNTER</code>, None if not supported */
+    unsigned long long sync_value; /**< last value requested from (or reached by) the counter */
+    unsigned long stamp;    /**< last use, for eviction */
+} Client_t;
+
+#define STATES_BUCKETS  256
+
+/** state of a window kept until it is destroyed
+ * @struct ClientState_t
+ */
+typedef struct ClientState_s {
+    Window window;
+    bool ruled;             /**< rules have been applied @see apply_rules */
+    bool ignored;           /**< left alone by a rule: never tiled */
+    int monitor;            /**< monitor given by a rule, -1 if none */
+    int split_leaf;         /**< leaf of the window in its split tree + 1, 0 if none @see Splits */
+    unsigned long tile_order; /**< order of arrival in auto-tiling, 0 if not auto-tiled */
+    bool class_known;       /**< correction has been looked up @see correct_geometry */
+    int correction;         /**< index in the corrections table, -1 if none */
+    Geometry_t requested;   /**< geometry last sent to X, after correction */
+    bool learning;          /**< ConfigureNotify events are to be learned from */
+    struct ClientState_s *next; /**< next state in the same bucket */
+} ClientState_t;
+
+Client_t *get_client(Window);
+Client_t *add_client(Window);
+void forget_client(Window);
+const Client_t *get_client_slot(int);
+ClientState_t *get_state(Window);
+ClientState_t *add_state(Window);
+bool is_ignored(Window);
+
+#endif /* CLIENTS_H */
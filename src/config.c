@@ -21,6 +21,7 @@
 #include <math.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <ctype.h>
 
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
@@ -32,14 +33,23 @@
 #include "keybindings.h"
 #include "config.h"
 #include "geometries.h"
+#include "rules.h"
+#include "pace.h"
 
 
-static const char *optstring = "hvfFc:V";
+static const char *optstring = "hvfFc:t:V";
 static const struct option longopts[] = {
     {"foreground",  0, NULL, 'f'},
     {"force",       0, NULL, 'F'},
     {"compiz",      0, NULL, 'C'},
+    {"snap",        0, NULL, 'S'},
+    {"plan",        1, NULL, 'P'},
+    {"record",      1, NULL, 'R'},
+    {"replay",      1, NULL, 'Y'},
+    {"socket",      1, NULL, 'K'},
+    {"status",      1, NULL, 'U'},
     {"verbose",     0, NULL, 'v'},
+    {"trace",       1, NULL, 't'},
     {"version",     0, NULL, 'V'},
     {"help",        0, NULL, 'h'},
     {NULL,          0, NULL,   0},
@@ -51,10 +61,25 @@ struct settings_t settings = {
     false,            /* foreground */
     false,            /* is_compiz */
     false,            /* force_run */
+    false,            /* snap */
+    0,                /* autotile_monitors */
+    0,                /* autotile_desktops */
+    150,              /* autotile_delay */
+    0,                /* pace: fire-and-forget */
+    100,              /* pace_timeout */
     0,                /* nb_monitors */
     0,                /* nb_desktop */
     "",               /* conf filename */
     "/tmp/tiler.pid", /* pid filename */
+    "",               /* trace filename */
+    "",               /* layout snapshot filename */
+    "",               /* plan filename */
+    "/tmp/tiler.flight", /* flight recorder dump filename */
+    "",               /* record filename */
+    "",               /* replay filename */
+    "",               /* geometry corrections filename */
+    "",               /* socket filename */
+    "",               /* status page filename */
 
 };
 
@@ -70,7 +95,14 @@ usage()
            "  -F  --force                 Force program to start even if a pid file is detected \n"
            "  -c  --config-file <file>    Use <file> instead of ~/.config/tiler.conf as a configuration file \n"
            "      --compiz                Force Compiz behaviour even if not detected\n"
-           "  -v  --verbose               Print various messages \n"
+           "      --snap                  Place windows dragged to a screen edge or corner \n"
+           "      --plan <file>           Print the layout of the setup described in <file>, without X, and exit \n"
+           "      --record <file>         Write the X state and the events received to <file> \n"
+           "      --replay <file>         Replay a recorded session, print actions latency and exit \n"
+           "      --socket <file>|off     Listen on <file> instead of $XDG_RUNTIME_DIR/tiler.socket \n"
+           "      --status <file>|off     Publish status in <file> instead of $XDG_RUNTIME_DIR/tiler.status \n"
+           "  -v  --verbose               Print various messages, twice for debug messages \n"
+           "  -t  --trace <file>          Write X requests to <file> (Chrome trace format) on SIGUSR1 and exit \n"
            "  -V  --version               Print version number and exit \n"
            "  -h  --help                  Print this message and exit \n"
           );
@@ -88,6 +120,19 @@ version()
     exit(0);
 }
 
+/* --socket or --status given: wins over the configuration file */
+static bool socket_option = false, status_option = false;
+
+/** File of the runtime directory, "off" for none @see Ipc, Status */
+static void
+set_runtime_file(char *file, size_t size, const char *value)
+{
+    if(STREQ(value, "off"))
+        file[0] = '\0';
+    else
+        snprintf(file, size, "%s", value);
+}
+
 /**
  * Parse command line arguments
  * @see Settings_t
@@ -97,6 +142,12 @@ parse_opt(int argc, char **argv)
 {
     int opt, index;
 
+    /* before the options, which may turn them off */
+    if(getenv("XDG_RUNTIME_DIR") != NULL) {
+        snprintf(settings.socket_file, sizeof(settings.socket_file), "%s/tiler.socket", getenv("XDG_RUNTIME_DIR"));
+        snprintf(settings.status_file, sizeof(settings.status_file), "%s/tiler.status", getenv("XDG_RUNTIME_DIR"));
+    }
+
     while((opt = getopt_long(argc, argv, optstring, longopts, &index)) != -1) {
         switch(opt) {
         case 'h':
@@ -104,13 +155,37 @@ parse_opt(int argc, char **argv)
             break;
         case 'v':
             settings.verbose = true;
+            log_verbosity = MIN(log_verbosity + 1, LOG_DEBUG);
             break;
         case 'c':
             strcpy(settings.filename, optarg);
             break;
+        case 't':
+            strncpy(settings.trace_file, optarg, sizeof(settings.trace_file) - 1);
+            break;
         case 'C':
             settings.is_compiz = true;
             break;
+        case 'S':
+            settings.snap = true;
+            break;
+        case 'P':
+            strncpy(settings.plan_file, optarg, sizeof(settings.plan_file) - 1);
+            break;
+        case 'R':
+            strncpy(settings.record_file, optarg, sizeof(settings.record_file) - 1);
+            break;
+        case 'Y':
+            strncpy(settings.replay_file, optarg, sizeof(settings.replay_file) - 1);
+            break;
+        case 'K':
+            set_runtime_file(settings.socket_file, sizeof(settings.socket_file), optarg);
+            socket_option = true;
+            break;
+        case 'U':
+            set_runtime_file(settings.status_file, sizeof(settings.status_file), optarg);
+            status_option = true;
+            break;
         case 'V':
             version();
             break;
@@ -130,6 +205,14 @@ parse_opt(int argc, char **argv)
         strcpy(settings.filename, getenv("HOME"));
         strcat(settings.filename, "/.config/tiler.conf");
     }
+
+    if(getenv("XDG_CACHE_HOME") != NULL) {
+        snprintf(settings.layout_file, sizeof(settings.layout_file), "%s/tiler.layout", getenv("XDG_CACHE_HOME"));
+        snprintf(settings.corrections_file, sizeof(settings.corrections_file), "%s/tiler.corrections", getenv("XDG_CACHE_HOME"));
+    } else {
+        snprintf(settings.layout_file, sizeof(settings.layout_file), "%s/.cache/tiler.layout", getenv("HOME"));
+        snprintf(settings.corrections_file, sizeof(settings.corrections_file), "%s/.cache/tiler.corrections", getenv("HOME"));
+    }
 }
 
 /**
@@ -160,6 +243,68 @@ parse_line(char *token, char *value)
         return;
     }
 
+    /**
+     * auto-tiling: "all" or a list such as "monitor:0,desktop:2"
+     */
+    if(STREQ(token, "autotile")) {
+        char *subvalue = strtok(value, ",");
+        int id;
+
+        while(subvalue != NULL) {
+            if(STREQ(subvalue, "all"))
+                settings.autotile_monitors = ~0U;
+            else if(sscanf(subvalue, "monitor:%d", &id) == 1 && id >= 0 && id < 32)
+                settings.autotile_monitors |= 1U << id;
+            else if(sscanf(subvalue, "desktop:%d", &id) == 1 && id >= 0 && id < 32)
+                settings.autotile_desktops |= 1U << id;
+            else
+                WARN(("Unknown autotile value \"%s\"", subvalue));
+
+            subvalue = strtok(NULL, ",");
+        }
+
+        return;
+    }
+
+    if(STREQ(token, "rule")) {
+        add_rule(value);
+        return;
+    }
+
+    if(STREQ(token, "autotile_delay")) {
+        settings.autotile_delay = MAX(0, atoi(value));
+        return;
+    }
+
+    if(STREQ(token, "pace")) {
+        if(STREQ(value, "off"))
+            settings.pace = PACE_OFF;
+        else if(STREQ(value, "measure"))
+            settings.pace = PACE_MEASURE;
+        else if(atoi(value) > 0)
+            settings.pace = MIN(atoi(value), PACE_MAX);
+        else
+            WARN(("invalid pace \"%s\"", value));
+        return;
+    }
+
+    if(STREQ(token, "socket")) {
+        if(!socket_option)
+            set_runtime_file(settings.socket_file, sizeof(settings.socket_file), value);
+        return;
+    }
+
+    if(STREQ(token, "status")) {
+        if(!status_option)
+            set_runtime_file(settings.status_file, sizeof(settings.status_file), value);
+        return;
+    }
+
+    if(STREQ(token, "pace_timeout")) {
+        settings.pace_timeout = MAX(1, atoi(value));
+        return;
+    }
+
     /**
      * token parsing
      */
@@ -185,7 +330,7 @@ parse_line(char *token, char *value)
 
 /** Parse configuration file
  *
- * Currently only contains keybinding informations
+ * Contains keybindings, auto-tiling settings and window rules
  * @param filename file to be processed
  */
 void
@@ -194,7 +339,8 @@ parse_conf_file(char *filename)
     FILE *fd;
     char buffer[256];
     char token[32];
-    char value[32];
+    char value[256];
+    int end;
 
     fd = fopen(filename, "r");
 
@@ -204,7 +350,10 @@ parse_conf_file(char *filename)
 
     while(fgets(buffer, sizeof(buffer), fd) != NULL) {
         if(*buffer != '#' && *buffer != '\n') {
-            sscanf(buffer, "%s = %s", token, value);
+            /* values run to the end of the line (rules) */
+            sscanf(buffer, "%31s = %255[^\n]", token, value);
+            for(end = strlen(value); end > 0 && isspace((unsigned char) value[end-1]); end--)
+                value[end-1] = '\0';
             parse_line(token, value);
         }
 
@@ -279,16 +428,28 @@ print_config()
            "  - foreground       %s \n"\
            "  - is compiz        %s \n"\
            "  - force run        %s \n"\
+           "  - drag-to-snap     %s \n"\
+           "  - auto-tiling      monitors 0x%x, desktops 0x%x (%d ms) \n"\
+           "  - pace             %d (timeout %d ms) \n"\
            "  - nb monitors      %d \n"\
            "  - config file      %s \n"\
-           "  - pid file         %s \n",
+           "  - pid file         %s \n"\
+           "  - trace file       %s \n"\
+           "  - layout file      %s \n"\
+           "  - socket           %s \n"\
+           "  - status page      %s \n",
            TILER_VERSION_STR,
            (settings.verbose ? "true" : "false"),
            (settings.foreground ? "true" : "false"),
            (settings.is_compiz ? "true" : "false"),
            (settings.force_run ? "true" : "false"),
+           (settings.snap ? "true" : "false"),
+           settings.autotile_monitors, settings.autotile_desktops, settings.autotile_delay,
+           settings.pace, settings.pace_timeout,
            settings.nb_monitors,
-           settings.filename, settings.pidfile
+           settings.filename, settings.pidfile, settings.trace_file, settings.layout_file,
+           settings.socket_file[0] ? settings.socket_file : "off",
+           settings.status_file[0] ? settings.status_file : "off"
           );
 
 }
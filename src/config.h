@@ -40,10 +40,25 @@ extern struct settings_t {
   bool foreground;
   bool is_compiz;
   bool force_run;
+  bool snap;
+  unsigned int autotile_monitors;   /* bit mask of auto-tiled monitors */
+  unsigned int autotile_desktops;   /* bit mask of auto-tiled desktops */
+  int autotile_delay;               /* debounce delay (ms) */
+  int pace;                         /* outstanding resizes, PACE_OFF or PACE_MEASURE */
+  int pace_timeout;                 /* wait for unacknowledged resizes (ms) */
   int nb_monitors;
   int nb_desktops;
   char filename[128];
   char pidfile[128];
+  char trace_file[128];
+  char layout_file[128];
+  char plan_file[128];
+  char flight_file[128];
+  char record_file[128];
+  char replay_file[128];
+  char corrections_file[128];
+  char socket_file[128];
+  char status_file[128];
 } settings;
 
 void parse_opt(int, char **);
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "clients.h"
+#include "corrections.h"
+
+static Correction_t table[CORRECTIONS_LEN];
+static int nb_corrections = 0;
+static bool dirty = false;
+
+/** Entry of a class, created if needed
+ * @return index in the table, -1 if it is full
+ */
+static int
+find_correction(const char *class)
+{
+    int i;
+
+    for(i = 0; i < nb_corrections; i++) {
+        if(STREQ(table[i].class, class))
+            return i;
+    }
+
+    if(nb_corrections == CORRECTIONS_LEN)
+        return -1;
+
+    memset(&table[nb_corrections], 0, sizeof(Correction_t));
+    snprintf(table[nb_corrections].class, CORRECTION_CLASS_LEN, "%s", class);
+    return nb_corrections++;
+}
+
+/**
+ * Read the corrections learned by previous runs
+ */
+void
+load_corrections()
+{
+    FILE *fd;
+    char buffer[256], class[CORRECTION_CLASS_LEN];
+    Geometry_t d;
+    unsigned int samples;
+    int i;
+
+    if((fd = fopen(settings.corrections_file, "r")) == NULL)
+        return;
+
+    while(fgets(buffer, sizeof(buffer), fd) != NULL) {
+        if(*buffer == '#')
+            continue;
+        if(sscanf(buffer, "%63s %d %d %d %d %u", class, &d.x, &d.y, &d.width, &d.height, &samples) != 6)
+            continue;
+        if((i = find_correction(class)) < 0)
+            break;
+        table[i].delta = d;
+        table[i].samples = samples;
+    }
+
+    fclose(fd);
+    D(("%d corrections loaded from \"%s\"", nb_corrections, settings.corrections_file));
+}
+
+/**
+ * Write the table if it changed since the last time
+ */
+void
+save_corrections()
+{
+    char tmp[sizeof(settings.corrections_file) + 8];
+    FILE *fd;
+    int i;
+
+    if(!dirty || settings.corrections_file[0] == '\0')
+        return;
+    dirty = false;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", settings.corrections_file);
+    if((fd = fopen(tmp, "w")) == NULL) {
+        WARN(("Unable to write \"%s\"", tmp));
+        return;
+    }
+
+    fprintf(fd, "# class dx dy dwidth dheight samples\n");
+    for(i = 0; i < nb_corrections; i++) {
+        if(table[i].samples == 0)
+            continue;
+        fprintf(fd, "%s %d %d %d %d %u\n", table[i].class,
+                table[i].delta.x, table[i].delta.y, table[i].delta.width, table[i].delta.height,
+                table[i].samples);
+    }
+
+    if(fclose(fd) != 0 || rename(tmp, settings.corrections_file) != 0) {
+        WARN(("Unable to write \"%s\"", settings.corrections_file));
+        unlink(tmp);
+    }
+}
+
+/**
+ * Geometry to ask for a window to end at the given one, and start
+ * learning from the events that follow
+ * @note fetches the class of windows placed for the first time
+ */
+Geometry_t
+correct_geometry(Display *display, Client_t *client, Geometry_t geometry)
+{
+    char instance[CORRECTION_CLASS_LEN], class[CORRECTION_CLASS_LEN];
+    ClientState_t *state = add_state(client->window);
+    Correction_t *c;
+    char *s;
+
+    if(!state->class_known) {
+        watch_client(display, client);
+        state->class_known = true;
+        state->correction = -1;
+        if(get_window_class(display, client->window, instance, class, CORRECTION_CLASS_LEN) && *class) {
+            /* one word per class in the file */
+            for(s = class; *s != '\0'; s++) {
+                if(*s == ' ')
+                    *s = '_';
+            }
+            state->correction = find_correction(class);
+        }
+    }
+
+    if(state->correction >= 0) {
+        c = &table[state->correction];
+        geometry.x -= c->delta.x;
+        geometry.y -= c->delta.y;
+        if(!(client->hints_known && (client->hints.inc[0] > 1 || client->hints.inc[1] > 1))) {
+            geometry.width -= c->delta.width;
+            geometry.height -= c->delta.height;
+        }
+    }
+
+    state->requested = geometry;
+    state->learning = (state->correction >= 0);
+
+    return geometry;
+}
+
+static void
+update_delta(int *delta, int value)
+{
+    if(*delta != value) {
+        *delta = value;
+        dirty = true;
+    }
+}
+
+/**
+ * Learn from a ConfigureNotify received after a placement
+ * @note worker only
+ */
+void
+learn_correction(XConfigureEvent *event)
+{
+    ClientState_t *state = get_state(event->window);
+    Client_t *client;
+    Correction_t *c;
+    int dx, dy, dw, dh;
+
+    if(state == NULL || !state->learning)
+        return;
+
+    c = &table[state->correction];
+    dw = event->width - state->requested.width;
+    dh = event->height - state->requested.height;
+    dx = event->x - state->requested.x;
+    dy = event->y - state->requested.y;
+
+    /* moved or resized by hand: not the WM's doing */
+    if(abs(dw) > CORRECTION_MAX || abs(dh) > CORRECTION_MAX
+            || (event->send_event && (abs(dx) > CORRECTION_MAX || abs(dy) > CORRECTION_MAX))) {
+        state->learning = false;
+        return;
+    }
+
+    c->samples++;
+
+    /* requests are corrected already, the difference seen is still the whole one */
+    client = get_client(event->window);
+    if(!(client != NULL && client->hints_known && (client->hints.inc[0] > 1 || client->hints.inc[1] > 1))) {
+        update_delta(&c->delta.width, dw);
+        update_delta(&c->delta.height, dh);
+    }
+
+    /* root coordinates: the WM is done with this placement */
+    if(event->send_event) {
+        update_delta(&c->delta.x, dx);
+        update_delta(&c->delta.y, dy);
+        state->learning = false;
+    }
+}
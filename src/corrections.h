@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CORRECTIONS_H
+#define CORRECTIONS_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+#include "clients.h"
+
+/**
+  @page Corrections
+
+  Some WMs and applications systematically shift or clamp the geometry
+  they are asked for (a frame counted in or out, a size rounded). Tiler
+  learns it per <code>WM_CLASS</code>: the <code>ConfigureNotify</code>
+  events following a placement give the geometry the window actually
+  ended at, the difference with the request is kept for the class and
+  subtracted from the following requests up front.
+
+  Size differences are taken from any ConfigureNotify, positions only from
+  the synthetic ones the WM sends in root coordinates (ICCCM 4.1.5).
+  Differences larger than CORRECTION_MAX pixels are the user moving the
+  window rather than the WM adjusting it, and end the learning for this
+  placement. Windows with resize increments only learn their position, their
+  size being rounded differently each time (see solve_hints()).
+
+  Events are read by the worker from its own connection at the start of
+  each action (see drain_client_events()), without any round trip. The
+  table is written to <code>$XDG_CACHE_HOME/tiler.corrections</code> when
+  it changes and at exit, and read at startup.
+  */
+
+/** classes remembered at most */
+#define CORRECTIONS_LEN     256
+#define CORRECTION_CLASS_LEN 64
+
+/** largest difference learned, in pixels */
+#define CORRECTION_MAX      50
+
+/** learned difference for a class
+ * @struct Correction_t
+ */
+typedef struct {
+    char class[CORRECTION_CLASS_LEN];
+    Geometry_t delta;       /**< actual geometry - requested geometry */
+    unsigned int samples;   /**< events learned from */
+} Correction_t;
+
+void load_corrections();
+void save_corrections();
+Geometry_t correct_geometry(Display *, Client_t *, Geometry_t);
+void learn_correction(XConfigureEvent *);
+
+#endif /* CORRECTIONS_H */
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "trace.h"
+#include "flight.h"
+
+static FlightEvent_t ring[FLIGHT_LEN];
+static unsigned long head = 0;
+
+static const char *kind_names[FLIGHT_KINDS] = {"key", "queued", "begin", "end"};
+
+/**
+ * Record an event, from any thread
+ */
+void
+flight_record(FlightKind_t kind, Move_t move, Window window,
+              unsigned int data0, unsigned int data1, unsigned int data2, unsigned int data3)
+{
+    unsigned long index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    FlightEvent_t *event = &ring[index & (FLIGHT_LEN - 1)];
+
+    /* being written */
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    event->time = trace_now();
+    event->kind = kind;
+    event->move = move;
+    event->window = window;
+    event->data[0] = data0;
+    event->data[1] = data1;
+    event->data[2] = data2;
+    event->data[3] = data3;
+
+    __atomic_store_n(&event->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Write the recorded events, oldest first
+ * Events being written (or overwritten) while dumping are skipped.
+ * @param filename  file to write to, settings.flight_file if NULL
+ */
+void
+flight_dump(const char *filename)
+{
+    unsigned long end = __atomic_load_n(&head, __ATOMIC_ACQUIRE), i;
+    unsigned long long previous = 0;
+    FlightEvent_t event;
+    FILE *fd;
+    int written = 0;
+
+    if(filename == NULL)
+        filename = settings.flight_file;
+
+    if((fd = fopen(filename, "w")) == NULL) {
+        WARN(("Unable to write \"%s\"", filename));
+        return;
+    }
+
+    fprintf(fd, "# time (s)         delta (us) event   binding       window      data\n");
+
+    for(i = (end > FLIGHT_LEN) ? end - FLIGHT_LEN : 0; i < end; i++) {
+        const FlightEvent_t *slot = &ring[i & (FLIGHT_LEN - 1)];
+
+        if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != i + 1)
+            continue;
+        memcpy(&event, slot, sizeof(event));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != i + 1)
+            continue;
+
+        fprintf(fd, "%llu.%09llu %10llu %-7s %-13s 0x%-9lx",
+                event.time / 1000000000ULL, event.time % 1000000000ULL,
+                previous ? (event.time - previous) / 1000 : 0,
+                kind_names[event.kind],
+                (event.move < MOVESLEN) ? bindings_reference[event.move].name : "-",
+                event.window);
+        previous = event.time;
+
+        switch(event.kind) {
+        case FLIGHT_KEY:
+            fprintf(fd, " keycode %u\n", event.data[0]);
+            break;
+        case FLIGHT_BEGIN:
+            fprintf(fd, " waited %u us\n", event.data[0]);
+            break;
+        case FLIGHT_END:
+            fprintf(fd, " %u round trips, %u requests, X %u us, total %u us\n",
+                    event.data[0], event.data[1], event.data[2], event.data[3]);
+            break;
+        default:
+            fprintf(fd, "\n");
+            break;
+        }
+        written++;
+    }
+
+    fclose(fd);
+    INFO(("%d events written to \"%s\"", written, filename));
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef FLIGHT_H
+#define FLIGHT_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Flight
+
+  Flight recorder: the last FLIGHT_LEN events (key presses, queued actions,
+  actions begin and end with their X requests counts and timings) are kept
+  in memory at all times, to find out afterwards what made tiler slow.
+
+  The ring is written without lock by both threads: a slot is claimed with
+  an atomic increment and published by storing its sequence number last,
+  recording costs a clock read and a few stores. It is dumped as text on
+  <code>SIGUSR2</code> and when tiler dies on a FATAL error.
+  */
+
+/** number of events kept (power of two) */
+#define FLIGHT_LEN  4096
+
+/** kinds of events */
+typedef enum {
+    FLIGHT_KEY,         /**< key press: keycode, binding */
+    FLIGHT_QUEUED,      /**< action queued for the worker */
+    FLIGHT_BEGIN,       /**< action started: time waited in queue (us) */
+    FLIGHT_END,         /**< action done: round trips, requests, X time (us), total time (us) */
+    FLIGHT_KINDS
+} FlightKind_t;
+
+/** recorded event
+ * @struct FlightEvent_t
+ */
+typedef struct {
+    unsigned long seq;          /**< index + 1, once written */
+    unsigned long long time;    /**< trace_now() */
+    unsigned char kind;         /**< FlightKind_t */
+    unsigned char move;         /**< Move_t, MOVESLEN if none */
+    Window window;
+    unsigned int data[4];       /**< depends on kind */
+} FlightEvent_t;
+
+void flight_record(FlightKind_t, Move_t, Window, unsigned int, unsigned int, unsigned int, unsigned int);
+void flight_dump(const char *);
+
+#endif /* FLIGHT_H */
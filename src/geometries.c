@@ -28,6 +28,7 @@
 #include "keybindings.h"
 #include "config.h"
 #include "xactions.h"
+#include "arena.h"
 
 
 /** Compute data for each callback for a given monitor
@@ -146,59 +147,356 @@ void compute_geometries_for_monitor(int monitor_id, Binding_t *monitor_bindings)
 }
 
 
-/** Custom workarea finder handling multiple screens
+/** Geometry of a zone at a given size step
  *
- * Standard way is to use <code>_NET_WORKAREA</code> atom. However it
- * is not suited for multi-monitors systems (returns a single rectangle large enough to
- * contains every monitor).
+ * Step 0 is the plain zone as computed by compute_geometries_for_monitor(),
+ * following steps resize the zone along its split dimension (1/2, 1/3 then
+ * 2/3 of the work area) keeping it stuck to its side of the screen.
+ * Corners are resized horizontally, MAXIMIZE is the whole work area.
+ *
+ * @param[in]   monitor_id  target monitor
+ * @param[in]   zone        one of the "move" bindings, or MAXIMIZE
+ * @param[in]   ratio       size step, from 0 to NB_ZONE_RATIOS - 1
+ * @param[out]  geometry    where to put result of calculation
+ */
+void get_zone_geometry(int monitor_id, Move_t zone, int ratio, Geometry_t *geometry)
+{
+    static const int numerator[NB_ZONE_RATIOS]   = {1, 1, 2};
+    static const int denominator[NB_ZONE_RATIOS] = {2, 3, 3};
+    Geometry_t area = settings.monitors[monitor_id].workarea;
+
+    if(zone == MAXIMIZE) {
+        *geometry = area;
+        return;
+    }
+
+    *geometry = * (Geometry_t *) bindings[monitor_id][zone].data;
+    if(ratio <= 0 || ratio >= NB_ZONE_RATIOS)
+        return;
+
+    switch(zone) {
+    case TOP:
+    case BOTTOM:
+        geometry->height = area.height * numerator[ratio] / denominator[ratio];
+        if(zone == BOTTOM)
+            geometry->y = area.y + area.height - geometry->height;
+        break;
+    default:
+        geometry->width = area.width * numerator[ratio] / denominator[ratio];
+        if(zone == RIGHT || zone == TOPRIGHT || zone == BOTTOMRIGHT)
+            geometry->x = area.x + area.width - geometry->width;
+        break;
+    }
+}
+
+/** Split a monitor into tiles for a number of windows
+ *
+ * @li 1 window: the whole workarea
+ * @li 2 windows: side by side
+ * @li 3 windows: first one on the left, two others on the right
+ * @li 4 windows: on a grid
+ * @li more: rows of up to ceil(sqrt(n)) tiles, the last row being stretched
+ *
+ * Up to 4 windows, tiles are the usual zones and are reported as such.
+ *
+ * @param[in]   monitor_id  target monitor
+ * @param[in]   size        number of tiles wanted
+ * @param[out]  tiles       size geometries
+ * @param[out]  zones       zone of each tile, MOVESLEN if it is not one (may be NULL)
+ */
+void plan_grid(int monitor_id, int size, Geometry_t *tiles, Move_t *zones)
+{
+    static const Move_t layouts[4][4] = {
+        {MAXIMIZE},
+        {LEFT, RIGHT},
+        {LEFT, TOPRIGHT, BOTTOMRIGHT},
+        {TOPLEFT, TOPRIGHT, BOTTOMLEFT, BOTTOMRIGHT},
+    };
+    Geometry_t area = settings.monitors[monitor_id].workarea;
+    int i, columns, rows, row, in_row;
+
+    if(size <= 0)
+        return;
+
+    if(size <= 4) {
+        for(i = 0; i < size; i++) {
+            get_zone_geometry(monitor_id, layouts[size-1][i], 0, &tiles[i]);
+            if(zones != NULL)
+                zones[i] = layouts[size-1][i];
+        }
+        return;
+    }
+
+    for(columns = 1; columns * columns < size; columns++)
+        ;
+    rows = (size + columns - 1) / columns;
+
+    for(i = 0; i < size; i++) {
+        row = i / columns;
+        in_row = MIN(columns, size - row * columns);
+
+        tiles[i].width  = area.width / in_row;
+        tiles[i].height = area.height / rows;
+        tiles[i].x = area.x + (i % columns) * tiles[i].width;
+        tiles[i].y = area.y + row * tiles[i].height;
+
+        if(zones != NULL)
+            zones[i] = MOVESLEN;
+    }
+}
+
+#define POS(g, axis)    ((axis) ? (g).y : (g).x)
+#define LEN(g, axis)    ((axis) ? (g).height : (g).width)
+
+/** Longest length up to <code>length</code> a window accepts
+ * @return at least the minimum length of the window
+ */
+static int fit_length(int length, const SizeHints_t *hints, int axis)
+{
+    int base = hints->base[axis], inc = hints->inc[axis];
+
+    if(inc > 1 && length > base)
+        length = base + ((length - base) / inc) * inc;
+
+    return MAX(length, hints->min[axis]);
+}
+
+/**
+ * Lay out cells one after the other along an axis
+ *
+ * Fixed cells (fitted[i] >= 0) get their fitted length, flexible cells share
+ * what is left in proportion of their original length, the last one taking
+ * the rounding pixels. Without any flexible cell, cells keep their place.
+ *
+ * @param[in]   start       position of the first cell
+ * @param[in]   lengths     original lengths
+ * @param[in]   fitted      lengths the cells accept, -1 for flexible cells
+ * @param[out]  positions, sizes
+ */
+static void distribute(int start, const int *lengths, const int *fitted, int n, int *positions, int *sizes)
+{
+    int i, total = 0, fixed = 0, flexible = 0, last = -1, left, given = 0;
+
+    for(i = 0; i < n; i++) {
+        total += lengths[i];
+        if(fitted[i] >= 0) {
+            fixed += fitted[i];
+        } else {
+            flexible += lengths[i];
+            last = i;
+        }
+    }
+
+    left = MAX(total - fixed, 0);
+    for(i = 0; i < n; i++) {
+        positions[i] = start;
+        if(fitted[i] >= 0)
+            sizes[i] = fitted[i];
+        else if(i == last)
+            sizes[i] = left - given;
+        else
+            given += sizes[i] = (int) ((long long) left * lengths[i] / MAX(flexible, 1));
+
+        start += (last < 0) ? lengths[i] : sizes[i];
+    }
+}
+
+/**
+ * Solve a layout made of strips (rows if axis is 1, columns if 0), each
+ * strip being split the other way
+ * @return false if the tiles are not laid out in such strips
+ */
+static bool solve_strips(int size, const SizeHints_t *hints, Geometry_t *tiles, int axis)
+{
+    int strip_of[HINTS_MAX], strip_pos[HINTS_MAX], strip_len[HINTS_MAX], order[HINTS_MAX];
+    int lengths[HINTS_MAX], fitted[HINTS_MAX], positions[HINTS_MAX], sizes[HINTS_MAX];
+    int cells[HINTS_MAX], pos[HINTS_MAX], len[HINTS_MAX];
+    int nb_strips = 0, nb_cells, i, j, k, s, other = !axis;
+    bool flexible;
+
+    /* strips: tiles sharing the same band */
+    for(i = 0; i < size; i++) {
+        for(k = 0; k < nb_strips; k++) {
+            if(strip_pos[k] == POS(tiles[i], axis) && strip_len[k] == LEN(tiles[i], axis))
+                break;
+        }
+        if(k == nb_strips) {
+            strip_pos[k] = POS(tiles[i], axis);
+            strip_len[k] = LEN(tiles[i], axis);
+            nb_strips++;
+        }
+        strip_of[i] = k;
+    }
+
+    /* in order, and not overlapping */
+    for(k = 0; k < nb_strips; k++) {
+        for(j = k; j > 0 && strip_pos[order[j-1]] > strip_pos[k]; j--)
+            order[j] = order[j-1];
+        order[j] = k;
+    }
+    for(k = 1; k < nb_strips; k++) {
+        if(strip_pos[order[k-1]] + strip_len[order[k-1]] > strip_pos[order[k]])
+            return false;
+    }
+
+    /* strips thickness: the largest size all their windows accept, unless one is
+       flexible and none needs more than the strip (minimum size) */
+    for(k = 0; k < nb_strips; k++) {
+        s = order[k];
+        lengths[k] = strip_len[s];
+        fitted[k] = 0;
+        flexible = false;
+        for(i = 0; i < size; i++) {
+            if(strip_of[i] != s)
+                continue;
+            flexible |= (hints[i].inc[axis] <= 1);
+            fitted[k] = MAX(fitted[k], fit_length(strip_len[s], &hints[i], axis));
+        }
+        if(flexible && fitted[k] <= strip_len[s])
+            fitted[k] = -1;
+    }
+    distribute(strip_pos[order[0]], lengths, fitted, nb_strips, positions, sizes);
+    for(k = 0; k < nb_strips; k++) {
+        pos[order[k]] = positions[k];
+        len[order[k]] = sizes[k];
+    }
+
+    /* then each strip along the other axis */
+    for(s = 0; s < nb_strips; s++) {
+        for(nb_cells = 0, i = 0; i < size; i++) {
+            if(strip_of[i] != s)
+                continue;
+            for(j = nb_cells; j > 0 && POS(tiles[cells[j-1]], other) > POS(tiles[i], other); j--)
+                cells[j] = cells[j-1];
+            cells[j] = i;
+            nb_cells++;
+        }
+
+        for(j = 0; j < nb_cells; j++) {
+            i = cells[j];
+            lengths[j] = LEN(tiles[i], other);
+            fitted[j] = (hints[i].inc[other] <= 1 && hints[i].min[other] <= lengths[j]) ?
+                        -1 : fit_length(lengths[j], &hints[i], other);
+        }
+        distribute(POS(tiles[cells[0]], other), lengths, fitted, nb_cells, positions, sizes);
+
+        for(j = 0; j < nb_cells; j++) {
+            i = cells[j];
+            k = fit_length(len[s], &hints[i], axis);
+            if(axis) {
+                tiles[i].y = pos[s];
+                tiles[i].height = k;
+                tiles[i].x = positions[j];
+                tiles[i].width = sizes[j];
+            } else {
+                tiles[i].x = pos[s];
+                tiles[i].width = k;
+                tiles[i].y = positions[j];
+                tiles[i].height = sizes[j];
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Adjust tiles to the sizes their windows accept
+ *
+ * Windows with resize increments (terminals, editors) get the largest size
+ * they accept within their tile, and the pixels they leave are given to
+ * the flexible windows of the same row (or column), so that the layout
+ * keeps no gap the WM would otherwise leave. Rows (or columns) made of
+ * constrained windows only shrink, to the benefit of the others.
+ *
+ * Works on the layouts of plan_grid(): rows or columns of tiles. Other
+ * layouts only get each tile fitted in place.
+ *
+ * @param[in]       size    number of tiles
+ * @param[in]       hints   hints of the window of each tile
+ * @param[in,out]   tiles   geometries to adjust
+ */
+void solve_hints(int size, const SizeHints_t *hints, Geometry_t *tiles)
+{
+    int i;
+
+    if(size <= 0 || size > HINTS_MAX)
+        return;
+
+    if(solve_strips(size, hints, tiles, 1) || solve_strips(size, hints, tiles, 0))
+        return;
+
+    for(i = 0; i < size; i++) {
+        tiles[i].width = fit_length(tiles[i].width, &hints[i], 0);
+        tiles[i].height = fit_length(tiles[i].height, &hints[i], 1);
+    }
+}
+
+/** Usable area of a monitor, given the docks (panels, task bars...) around
  *
  * The real algorithm would me a Largest empty rectangle problem feeded with all
  * system windows (docks mostly). Currently we simplify a lot by assuming we only have docks
  * on the top or on the bottom and we shrink the monitor's size base on the dock's geometries
  *
- * @pre monitor physical size should be available (get_monitors_config())
+ * Does not need the X server: also used by the planning mode (--plan).
+ *
  * @param[in]   monitor_id  target monitor
+ * @param[in]   docks       geometries of the system windows, on any monitor
+ * @param[in]   nb_docks    size of docks
  * @param[out]  area        where to put result of calculation
  */
-void get_usable_area(int monitor_id, Geometry_t *area)
+void compute_usable_area(int monitor_id, const Geometry_t *docks, int nb_docks, Geometry_t *area)
 {
-    /* _NET_WORKAREA atom doesn't fit for multiple screen */
-    Window *window_list = NULL;
-    int i, size;
-
-    *area = settings.monitors[monitor_id].infos;
-
-    size = list_windows(display, root, &window_list, LIST_SYSTEM);
+    Geometry_t screen = settings.monitors[monitor_id].infos;
+    int i;
 
-    if(window_list == NULL)
-        return;
+    *area = screen;
 
     /* we simplify greatly the calculation, at least for now
       real problem is the "largest empty rectangle problem" */
-
-    Geometry_t geo;
-    int mon;
-    for(i = 0; i < size; i++) {
-        if((mon = get_window_monitor(window_list[i])) != monitor_id)
+    for(i = 0; i < nb_docks; i++) {
+        if(get_geometry_monitor(docks[i]) != monitor_id)
             continue;
 
-        get_window_geometry(display, window_list[i], &geo);
-
-        if(geo.width >= settings.monitors[monitor_id].infos.width
-                && geo.height >= settings.monitors[monitor_id].infos.height)
+        if(docks[i].width >= screen.width && docks[i].height >= screen.height)
             continue;
 
-        if(geo.y < settings.monitors[monitor_id].infos.height / 2) {
-            area->y = geo.y + geo.height;
-            area->height -= geo.height;
+        if(docks[i].y < screen.height / 2) {
+            area->y = docks[i].y + docks[i].height;
+            area->height -= docks[i].height;
         } else {
-            area->height -= geo.height;
+            area->height -= docks[i].height;
         }
     }
 
     D(("Usable area found: (%d, %d) (%d, %d) on monitor %d", area->x, area->y, area->width, area->height, monitor_id));
+}
+
+/** Custom workarea finder handling multiple screens
+ *
+ * Standard way is to use <code>_NET_WORKAREA</code> atom. However it
+ * is not suited for multi-monitors systems (returns a single rectangle large enough to
+ * contains every monitor).
+ *
+ * @pre monitor physical size should be available (get_monitors_config())
+ * @param[in]   monitor_id  target monitor
+ * @param[out]  area        where to put result of calculation
+ * @see compute_usable_area
+ */
+void get_usable_area(int monitor_id, Geometry_t *area)
+{
+    /* _NET_WORKAREA atom doesn't fit for multiple screen */
+    Window *window_list = NULL;
+    Geometry_t *docks;
+    int i, size;
+
+    size = list_windows(display, root, &window_list, LIST_SYSTEM);
+    docks = (Geometry_t *) arena_alloc(MAX(size, 1) * sizeof(Geometry_t));
+
+    for(i = 0; i < size; i++)
+        get_window_geometry(display, window_list[i], &docks[i]);
 
-    free(window_list);
+    compute_usable_area(monitor_id, docks, size, area);
 }
 
 /** Return the position of a base geometry relatively to a target geometry
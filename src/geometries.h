@@ -31,7 +31,17 @@ typedef enum {
     UNKNOWNPOS
 } Position_t;
 
+/** size steps of a zone, cycled by repeated presses of the same binding */
+#define NB_ZONE_RATIOS 3
+
+/** windows at most in a layout solved for size hints */
+#define HINTS_MAX 256
+
+void compute_usable_area(int, const Geometry_t *, int, Geometry_t *);
 void get_usable_area(int, Geometry_t *);
+void get_zone_geometry(int, Move_t, int, Geometry_t *);
+void plan_grid(int, int, Geometry_t *, Move_t *);
+void solve_hints(int, const SizeHints_t *, Geometry_t *);
 void compute_geometries_for_monitor(int, Binding_t *);
 void print_geometries();
 Position_t get_relative_position(Geometry_t, Geometry_t);
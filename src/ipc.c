@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xinerama.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "trace.h"
+#include "keybindings.h"
+#include "titles.h"
+#include "ipc.h"
+
+/** connection of a client */
+typedef struct {
+    int fd;                     /**< -1 for a free slot */
+    char line[IPC_LINE_LEN];    /**< request read so far */
+    int length;
+    char out[IPC_BUFFER_LEN];   /**< replies and events not sent yet */
+    int out_length;
+    bool subscribed;
+} IpcClient_t;
+
+static int listen_fd = -1;
+static IpcClient_t clients[IPC_CLIENTS];
+
+/* read by every thread to skip formatting events nobody listens to */
+static int nb_subscribers = 0;
+
+/* events published since the event loop last woke up, fit in a subscriber buffer twice */
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static char pending[IPC_BUFFER_LEN / 2];
+static int pending_length = 0;
+static int nb_lost = 0;
+
+/* written to when pending gets its first event, polled by the event loop */
+static int wakeup[2] = {-1, -1};
+
+/* longest reply: IPC_MATCHES lines and the final empty line */
+static char reply[IPC_MATCHES * (TITLE_LEN + TITLE_CLASS_LEN + 24) + 2];
+
+/** Never block the event loop, nor leak into children */
+static int
+set_nonblocking(int fd)
+{
+    if(fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+        return -1;
+
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * Listen on the socket
+ * @note does nothing if the socket is disabled
+ */
+void
+start_ipc()
+{
+    struct sockaddr_un address;
+    int i;
+
+    for(i = 0; i < IPC_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    if(settings.socket_file[0] == '\0')
+        return;
+
+    if(strlen(settings.socket_file) >= sizeof(address.sun_path)) {
+        WARN(("socket path \"%s\" is too long", settings.socket_file));
+        return;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, settings.socket_file);
+
+    /* left by a previous instance: the pid file keeps us alone */
+    unlink(settings.socket_file);
+
+    if((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+            || set_nonblocking(listen_fd) < 0
+            || bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) < 0
+            || chmod(settings.socket_file, S_IRUSR | S_IWUSR) < 0
+            || listen(listen_fd, IPC_CLIENTS) < 0) {
+        WARN(("cannot listen on \"%s\": %s", settings.socket_file, strerror(errno)));
+        if(listen_fd >= 0)
+            close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+
+    if(pipe(wakeup) < 0 || set_nonblocking(wakeup[0]) < 0 || set_nonblocking(wakeup[1]) < 0) {
+        WARN(("cannot create the event pipe: %s", strerror(errno)));
+        close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+
+    INFO(("Listening on %s", settings.socket_file));
+}
+
+/**
+ * Close the socket and remove it
+ * @note at exit, once the worker is stopped
+ */
+void
+stop_ipc()
+{
+    int i;
+
+    if(listen_fd < 0)
+        return;
+
+    for(i = 0; i < IPC_CLIENTS; i++) {
+        if(clients[i].fd >= 0)
+            close(clients[i].fd);
+    }
+
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(settings.socket_file);
+}
+
+/**
+ * Fill the poll() entries of the socket, its event pipe and its clients
+ * @param[out] fds  room for IPC_POLLFDS entries
+ * @return number of entries filled
+ */
+int
+ipc_pollfds(struct pollfd *fds)
+{
+    int i, n = 0;
+
+    if(listen_fd < 0)
+        return 0;
+
+    fds[n].fd = listen_fd;
+    fds[n].events = POLLIN;
+    fds[n++].revents = 0;
+
+    fds[n].fd = wakeup[0];
+    fds[n].events = POLLIN;
+    fds[n++].revents = 0;
+
+    for(i = 0; i < IPC_CLIENTS; i++) {
+        if(clients[i].fd < 0)
+            continue;
+        fds[n].fd = clients[i].fd;
+        fds[n].events = (clients[i].out_length > 0) ? POLLIN | POLLOUT : POLLIN;
+        fds[n++].revents = 0;
+    }
+
+    return n;
+}
+
+static void
+disconnect(IpcClient_t *client)
+{
+    if(client->subscribed)
+        __atomic_sub_fetch(&nb_subscribers, 1, __ATOMIC_RELAXED);
+
+    close(client->fd);
+    client->fd = -1;
+    client->length = 0;
+    client->out_length = 0;
+    client->subscribed = false;
+}
+
+/** Send what the socket takes without blocking, keep the rest for POLLOUT */
+static void
+flush_client(IpcClient_t *client)
+{
+    ssize_t n;
+
+    if(client->out_length == 0)
+        return;
+
+    n = send(client->fd, client->out, client->out_length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(n < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            disconnect(client);
+        return;
+    }
+
+    client->out_length -= n;
+    memmove(client->out, client->out + n, client->out_length);
+}
+
+/** Buffer data for a client, or give up on it if it does not keep up */
+static void
+queue(IpcClient_t *client, const char *data, int length)
+{
+    if(client->out_length + length > IPC_BUFFER_LEN) {
+        INFO(("Dropping socket client not reading its %s", client->subscribed ? "events" : "replies"));
+        disconnect(client);
+        return;
+    }
+
+    memcpy(client->out + client->out_length, data, length);
+    client->out_length += length;
+}
+
+static int
+print_title(int offset, const Title_t *t)
+{
+    return offset + snprintf(reply + offset, sizeof(reply) - offset, "0x%lx\t%s\t%s\n",
+                             t->window, t->class, t->title);
+}
+
+/** Window to switch to: an id, or the first match other than the active window */
+static const Title_t *
+pick_window(const char *text)
+{
+    const Title_t *matches[2];
+    char *end;
+    Window window = strtoul(text, &end, 16);
+    int n;
+
+    if(strncmp(text, "0x", 2) == 0 && *end == '\0')
+        return get_title(window);
+
+    if((n = find_titles(text, matches, 2)) == 0)
+        return NULL;
+
+    if(n == 2 && matches[0]->window == tracked_active_window())
+        return matches[1];
+
+    return matches[0];
+}
+
+static void
+handle_request(IpcClient_t *client, const char *request)
+{
+    const Title_t *matches[IPC_MATCHES];
+    const Title_t *t;
+    int i, n, length = 0;
+
+    if(strncmp(request, "find ", 5) == 0) {
+        n = find_titles(request + 5, matches, IPC_MATCHES);
+        for(i = 0; i < n; i++)
+            length = print_title(length, matches[i]);
+    } else if(strncmp(request, "switch ", 7) == 0) {
+        if((t = pick_window(request + 7)) != NULL) {
+            activate_window(event_display, t->window, tracked_active_window());
+            XFlush(event_display);
+            length = print_title(length, t);
+        }
+    } else if(strcmp(request, "subscribe") == 0) {
+        if(!client->subscribed)
+            __atomic_add_fetch(&nb_subscribers, 1, __ATOMIC_RELAXED);
+        client->subscribed = true;
+    } else {
+        D(("Unknown socket request \"%s\"", request));
+    }
+
+    reply[length++] = '\n';
+    queue(client, reply, length);
+}
+
+/** Read what a client sent, and answer its complete requests */
+static void
+read_requests(IpcClient_t *client)
+{
+    char *line, *end;
+    ssize_t n;
+
+    n = recv(client->fd, client->line + client->length, IPC_LINE_LEN - 1 - client->length, MSG_DONTWAIT);
+    if(n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        disconnect(client);
+        return;
+    }
+    if(n < 0)
+        return;
+
+    client->length += n;
+    client->line[client->length] = '\0';
+
+    line = client->line;
+    while(client->fd >= 0 && (end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+        if(end > line && end[-1] == '\r')
+            end[-1] = '\0';
+        handle_request(client, line);
+        line = end + 1;
+    }
+
+    if(client->fd < 0)
+        return;
+
+    flush_client(client);
+    if(client->fd < 0)
+        return;
+
+    client->length -= line - client->line;
+    memmove(client->line, line, client->length);
+
+    if(client->length == IPC_LINE_LEN - 1) {
+        INFO(("Dropping socket client: request too long"));
+        disconnect(client);
+    }
+}
+
+static void
+accept_client()
+{
+    int fd, i;
+
+    if((fd = accept(listen_fd, NULL, NULL)) < 0)
+        return;
+
+    if(set_nonblocking(fd) < 0) {
+        close(fd);
+        return;
+    }
+
+    for(i = 0; i < IPC_CLIENTS && clients[i].fd >= 0; i++)
+        ;
+
+    if(i == IPC_CLIENTS) {
+        INFO(("Too many socket clients"));
+        close(fd);
+        return;
+    }
+
+    clients[i].fd = fd;
+    clients[i].length = 0;
+    clients[i].out_length = 0;
+    clients[i].subscribed = false;
+}
+
+/**
+ * Queue an event line for the subscribers, formatted as printf() does
+ * Lines are sent by the event loop, which is woken up through a pipe.
+ * @note any thread, nothing is formatted without subscribers
+ */
+void
+ipc_publish(const char *format, ...)
+{
+    char line[IPC_LINE_LEN];
+    va_list args;
+    int length;
+    bool wake;
+
+    if(listen_fd < 0 || __atomic_load_n(&nb_subscribers, __ATOMIC_RELAXED) == 0)
+        return;
+
+    va_start(args, format);
+    length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    length = MIN(length, (int) sizeof(line) - 1);
+
+    pthread_mutex_lock(&pending_lock);
+    wake = (pending_length == 0 && nb_lost == 0);
+    if(pending_length + length <= (int) sizeof(pending)) {
+        memcpy(pending + pending_length, line, length);
+        pending_length += length;
+    } else {
+        nb_lost++;
+    }
+    pthread_mutex_unlock(&pending_lock);
+
+    /* full pipe: a wake up is already on its way */
+    if(wake && write(wakeup[1], "", 1) < 0 && errno != EAGAIN)
+        WARN(("cannot wake the event loop up: %s", strerror(errno)));
+}
+
+/** Hand the events published since the last call to every subscriber */
+static void
+fan_out()
+{
+    static char events[sizeof(pending) + 32];
+    char drain[64];
+    int i, length;
+
+    while(read(wakeup[0], drain, sizeof(drain)) > 0)
+        ;
+
+    pthread_mutex_lock(&pending_lock);
+    length = pending_length;
+    memcpy(events, pending, length);
+    if(nb_lost > 0)
+        length += sprintf(events + length, "lost %d\n", nb_lost);
+    pending_length = 0;
+    nb_lost = 0;
+    pthread_mutex_unlock(&pending_lock);
+
+    if(length == 0)
+        return;
+
+    for(i = 0; i < IPC_CLIENTS; i++) {
+        if(clients[i].fd < 0 || !clients[i].subscribed)
+            continue;
+        queue(&clients[i], events, length);
+        if(clients[i].fd >= 0)
+            flush_client(&clients[i]);
+    }
+}
+
+/** Publish the monitors as X reports them now */
+static void
+publish_monitors()
+{
+    char line[IPC_LINE_LEN];
+    XineramaScreenInfo *infos;
+    int i, n = 0, length;
+
+    if(XineramaIsActive(event_display)) {
+        XCALL(X_ROUNDTRIP, "XineramaQueryScreens", "", None,
+              infos = XineramaQueryScreens(event_display, &n));
+    } else {
+        infos = NULL;
+    }
+
+    if(infos == NULL) {
+        ipc_publish("monitors 1 0 0 %d %d\n", XDisplayWidth(event_display, XDefaultScreen(event_display)),
+                    XDisplayHeight(event_display, XDefaultScreen(event_display)));
+        return;
+    }
+
+    length = snprintf(line, sizeof(line), "monitors %d", n);
+    for(i = 0; i < n && length < (int) sizeof(line) - 48; i++)
+        length += sprintf(line + length, " %d %d %d %d", infos[i].x_org, infos[i].y_org,
+                          infos[i].width, infos[i].height);
+    XFree(infos);
+
+    ipc_publish("%s\n", line);
+}
+
+/**
+ * Publish workarea and monitor changes, from root window events
+ * @note event loop only
+ */
+void
+ipc_event(XEvent *event)
+{
+    static Atom workarea_atom = None;
+    Window root = XDefaultRootWindow(event_display);
+    int x, y, width, height;
+
+    if(listen_fd < 0 || __atomic_load_n(&nb_subscribers, __ATOMIC_RELAXED) == 0)
+        return;
+
+    if(event->type == PropertyNotify && event->xproperty.window == root) {
+        if(workarea_atom == None)
+            workarea_atom = get_atom(event_display, "_NET_WORKAREA");
+        if(event->xproperty.atom != workarea_atom)
+            return;
+
+        get_workarea(event_display, root, &x, &y, &width, &height);
+        ipc_publish("workarea %d %d %d %d\n", x, y, width, height);
+    } else if(event->type == ConfigureNotify && event->xconfigure.window == root) {
+        /* screen resized by RandR: outputs were added, removed or moved */
+        publish_monitors();
+    }
+}
+
+/**
+ * Serve the socket, after poll() returned
+ * @param fds   entries filled by ipc_pollfds()
+ * @note event loop only
+ */
+void
+ipc_handle(const struct pollfd *fds, int n)
+{
+    int i, j;
+
+    for(i = 2; i < n; i++) {
+        if(fds[i].revents == 0)
+            continue;
+
+        for(j = 0; j < IPC_CLIENTS && clients[j].fd != fds[i].fd; j++)
+            ;
+        if(j == IPC_CLIENTS)
+            continue;
+
+        if(fds[i].revents & POLLOUT)
+            flush_client(&clients[j]);
+        if(clients[j].fd >= 0 && (fds[i].revents & ~POLLOUT))
+            read_requests(&clients[j]);
+    }
+
+    if(n > 1 && (fds[1].revents & POLLIN))
+        fan_out();
+
+    if(n > 0 && (fds[0].revents & POLLIN))
+        accept_client();
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef IPC_H
+#define IPC_H
+
+#include <poll.h>
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Ipc
+
+  Tiler listens on a Unix socket, <code>$XDG_RUNTIME_DIR/tiler.socket</code>
+  by default, so that launchers and scripts can switch windows without
+  scanning X themselves. Requests are lines of text, and every reply ends
+  with an empty line:
+
+  @li <code>find text</code> lists the windows whose class or title
+  contains the text, case insensitive, most recently active first: one line
+  per window with its id, class and title separated by tabs
+  @li <code>switch text</code> activates the first of them which is not the
+  active window already, and replies with its line; <code>switch 0x1a00007</code>
+  activates a window by id
+
+  @li <code>subscribe</code> turns the connection into an event stream,
+  after an empty reply: one line per event, pushed as it happens
+
+  Events are:
+
+  @li <code>placed 0x1a00007 0 left</code>: a window was put in a zone of a
+  monitor (<code>none</code> for windows tiled outside of zones)
+  @li <code>monitors 2 0 0 1920 1080 1920 0 1280 1024</code>: the screen
+  was reconfigured, with the new monitors
+  @li <code>workarea 0 24 3200 1056</code>: the area left by panels changed
+  @li <code>action grid 412 3 17</code>: an action ran, with its latency
+  from the key press in microseconds, its round trips and its requests
+  @li <code>lost 12</code>: events dropped while the event loop was busy
+
+  Requests are answered by the event loop from the index of @ref Titles,
+  without any X round trip. Events are formatted only while somebody
+  listens, queued by the thread publishing them and fanned out by the event
+  loop. Connections are non blocking, with a buffer each: a client not
+  reading its replies or events fast enough is disconnected rather than
+  ever stalling the event loop.
+  */
+
+#define IPC_CLIENTS     16
+#define IPC_LINE_LEN    512
+
+/** output buffered for a client, before it is dropped */
+#define IPC_BUFFER_LEN  16384
+
+/** windows listed by a find request at most */
+#define IPC_MATCHES     32
+
+/** poll() entries needed by ipc_pollfds() */
+#define IPC_POLLFDS     (IPC_CLIENTS + 2)
+
+void start_ipc();
+void stop_ipc();
+int ipc_pollfds(struct pollfd *);
+void ipc_handle(const struct pollfd *, int);
+void ipc_publish(const char *, ...) __attribute__((format(printf, 1, 2)));
+void ipc_event(XEvent *);
+
+#endif /* IPC_H */
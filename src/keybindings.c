@@ -22,16 +22,41 @@
 
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
+#include <X11/XKBlib.h>
 
 #include "keybindings.h"
 #include "geometries.h"
 #include "callbacks.h"
 #include "config.h"
 #include "xactions.h"
+#include "worker.h"
+#include "trace.h"
+#include "snap.h"
+#include "autotile.h"
+#include "flight.h"
+#include "replay.h"
+#include "titles.h"
+#include "status.h"
+#include "ipc.h"
 #include "tiler.h"
 
 unsigned int modifiers = 0;
 
+/* binding of each keycode (MOVESLEN if none), rebuilt from the keymap */
+static unsigned char keycode_moves[KEYCODES_LEN];
+static bool grabbed[KEYCODES_LEN];
+
+/* lock modifiers combinations each key is grabbed with */
+static unsigned int locks[8];
+static int nb_locks = 0;
+
+static int xkb_event_type = -1;
+static bool keymap_dirty = false;
+
+/* last known _NET_ACTIVE_WINDOW, tracked from root PropertyNotify events */
+static Window active_window = None;
+static Atom active_window_atom = None;
+
 /**
  * contains the reference table of bindings
  * we need one table like this one for each monitor
@@ -51,6 +76,19 @@ const Binding_t bindings_reference[MOVESLEN] = {
     {"sidebyside",  XK_VoidSymbol, sidebyside,   NULL},
     {"maximize",    XK_VoidSymbol, maximize,     NULL},
     {"listwindows", XK_VoidSymbol, listwindows,  NULL},
+    {"relayout",    XK_VoidSymbol, relayout,     NULL},
+    {"savelayout",  XK_VoidSymbol, savelayout,   NULL},
+    {"restorelayout", XK_VoidSymbol, restorelayout, NULL},
+    {"growsplit",   XK_VoidSymbol, resizesplit,  NULL},
+    {"shrinksplit", XK_VoidSymbol, resizesplit,  NULL},
+    {"focusleft",   XK_VoidSymbol, focus,        NULL},
+    {"focusright",  XK_VoidSymbol, focus,        NULL},
+    {"focusup",     XK_VoidSymbol, focus,        NULL},
+    {"focusdown",   XK_VoidSymbol, focus,        NULL},
+    {"swapleft",    XK_VoidSymbol, swap,         NULL},
+    {"swapright",   XK_VoidSymbol, swap,         NULL},
+    {"swapup",      XK_VoidSymbol, swap,         NULL},
+    {"swapdown",    XK_VoidSymbol, swap,         NULL},
 };
 
 /**
@@ -64,8 +102,9 @@ Binding_t **bindings = NULL;
  */
 void grab(const KeyCode code, const unsigned int mod)
 {
-    XGrabKey(display, code, mod,
-             XDefaultRootWindow(display), 1, GrabModeAsync, GrabModeAsync);
+    XCALL(X_ONEWAY, "GrabKey", NULL, None,
+          XGrabKey(event_display, code, mod,
+                   XDefaultRootWindow(event_display), 1, GrabModeAsync, GrabModeAsync));
 }
 
 /**
@@ -73,12 +112,14 @@ void grab(const KeyCode code, const unsigned int mod)
  */
 void ungrab(const KeyCode code, const unsigned int mod)
 {
-    XUngrabKey(display, code, mod,
-               XDefaultRootWindow(display));
+    XCALL(X_ONEWAY, "UngrabKey", NULL, None,
+          XUngrabKey(event_display, code, mod,
+                     XDefaultRootWindow(event_display)));
 }
 
 /**
  * setup match between keysym key shortcut and move action
+ * Keys are actually grabbed by update_grabs(), once the configuration is read.
  * @param move      action to be executed
  * @param keysym    shortcut wanted for this action
  * @see Binding_t
@@ -97,13 +138,151 @@ void add_binding(Move_t move, KeySym keysym)
     /* same key shortcut for all monitors */
     for(i = 0; i < settings.nb_monitors; i++)
         bindings[i][move].keysym = keysym;
+}
+
+/**
+ * Modifier mask a key is mapped to, 0 if none
+ */
+static unsigned int modifier_of(XModifierKeymap *map, KeySym keysym)
+{
+    KeyCode code = XKeysymToKeycode(event_display, keysym);
+    int i;
+
+    if(code == 0)
+        return 0;
+
+    for(i = 0; i < 8 * map->max_keypermod; i++) {
+        if(map->modifiermap[i] == code)
+            return 1 << (i / map->max_keypermod);
+    }
 
-    /* set X listening event */
-    grab(XKeysymToKeycode(display, keysym), modifiers);
-    /* ignoring annoying NumLock (Mod2Mask) key */
-    grab(XKeysymToKeycode(display, keysym), modifiers | Mod2Mask);
+    return 0;
 }
 
+/**
+ * Every combination of CapsLock, NumLock and ScrollLock, which must not
+ * prevent bindings from matching
+ * @return number of (distinct) combinations
+ */
+static int lock_combinations(unsigned int *combinations)
+{
+    XModifierKeymap *map;
+    unsigned int lock[3], mask;
+    int i, j, n = 0;
+
+    XCALL(X_ROUNDTRIP, "GetModifierMapping", NULL, None,
+          map = XGetModifierMapping(event_display));
+
+    lock[0] = LockMask;
+    lock[1] = modifier_of(map, XK_Num_Lock);
+    lock[2] = modifier_of(map, XK_Scroll_Lock);
+    XFreeModifiermap(map);
+
+    for(i = 0; i < 8; i++) {
+        for(mask = 0, j = 0; j < 3; j++) {
+            if(i & (1 << j))
+                mask |= lock[j];
+        }
+
+        /* unmapped locks and locks used as binding modifier */
+        for(j = 0; j < n && (combinations[j] | modifiers) != (mask | modifiers); j++)
+            ;
+        if(j == n)
+            combinations[n++] = mask;
+    }
+
+    return n;
+}
+
+/**
+ * Rebuild the keycode table from the current keymap and update grabs
+ *
+ * Keysyms are resolved through XKB, on every keycode: a keysym reachable
+ * from several keys triggers its binding from any of them. Only keycodes
+ * whose binding appeared or disappeared are grabbed/released, unless lock
+ * modifiers moved. All requests go in a single batch.
+ */
+void update_grabs()
+{
+    unsigned char moves[KEYCODES_LEN];
+    unsigned int new_locks[8];
+    int new_nb_locks, min_keycode, max_keycode, code, i, j, changes = 0;
+    bool locks_changed;
+    KeySym keysym;
+
+    memset(moves, MOVESLEN, sizeof(moves));
+    XDisplayKeycodes(event_display, &min_keycode, &max_keycode);
+
+    for(code = min_keycode; code <= max_keycode && code < KEYCODES_LEN; code++) {
+        if((keysym = XkbKeycodeToKeysym(event_display, code, 0, 0)) == NoSymbol)
+            continue;
+
+        for(i = 0; i < MOVESLEN; i++) {
+            if(bindings[0][i].keysym == keysym) {
+                moves[code] = i;
+                break;
+            }
+        }
+    }
+
+    new_nb_locks = lock_combinations(new_locks);
+    locks_changed = (new_nb_locks != nb_locks
+                     || memcmp(new_locks, locks, new_nb_locks * sizeof(unsigned int)) != 0);
+
+    for(code = 0; code < KEYCODES_LEN; code++) {
+        if(grabbed[code] && (moves[code] == MOVESLEN || locks_changed)) {
+            for(j = 0; j < nb_locks; j++)
+                ungrab(code, modifiers | locks[j]);
+            grabbed[code] = false;
+            changes++;
+        }
+
+        if(moves[code] != MOVESLEN && !grabbed[code]) {
+            for(j = 0; j < new_nb_locks; j++)
+                grab(code, modifiers | new_locks[j]);
+            grabbed[code] = true;
+            changes++;
+        }
+    }
+
+    memcpy(keycode_moves, moves, sizeof(moves));
+    memcpy(locks, new_locks, sizeof(new_locks));
+    nb_locks = new_nb_locks;
+
+    XFlush(event_display);
+    keymap_dirty = false;
+
+    D(("keymap: %d keycodes grabbed/released, %d lock combinations", changes, nb_locks));
+}
+
+/**
+ * Start following keymap changes (setxkbmap, new keyboard) and grab keys
+ * @pre configuration file parsed
+ */
+void init_keymap()
+{
+    int opcode, error, major = XkbMajorVersion, minor = XkbMinorVersion;
+
+    if(!XkbQueryExtension(event_display, &opcode, &xkb_event_type, &error, &major, &minor))
+        FATAL(("XKB extension not available"));
+
+    XCALL(X_ONEWAY, "XkbSelectEvents", "NewKeyboardNotify|MapNotify", None,
+          XkbSelectEvents(event_display, XkbUseCoreKbd,
+                          XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+                          XkbNewKeyboardNotifyMask | XkbMapNotifyMask));
+
+    update_grabs();
+}
+
+/**
+ * Rebuild the keycode table once per burst of keymap notifications
+ * @note event loop only
+ */
+void keymap_flush()
+{
+    if(keymap_dirty)
+        update_grabs();
+}
 
 /**
  * add a modifier to observed key sequence
@@ -140,6 +319,19 @@ void add_modifier(unsigned int modmask)
  *        {"sidebyside",  XK_VoidSymbol, sidebyside,   NULL},
  *        {"maximize",    XK_VoidSymbol, maximize,     NULL},
  *        {"listwindows", XK_VoidSymbol, listwindows,  NULL},
+ *        {"relayout",    XK_VoidSymbol, relayout,     NULL},
+ *        {"savelayout",  XK_VoidSymbol, savelayout,   NULL},
+ *        {"restorelayout", XK_VoidSymbol, restorelayout, NULL},
+ *        {"growsplit",   XK_VoidSymbol, resizesplit,  NULL},
+ *        {"shrinksplit", XK_VoidSymbol, resizesplit,  NULL},
+ *        {"focusleft",   XK_VoidSymbol, focus,        NULL},
+ *        {"focusright",  XK_VoidSymbol, focus,        NULL},
+ *        {"focusup",     XK_VoidSymbol, focus,        NULL},
+ *        {"focusdown",   XK_VoidSymbol, focus,        NULL},
+ *        {"swapleft",    XK_VoidSymbol, swap,         NULL},
+ *        {"swapright",   XK_VoidSymbol, swap,         NULL},
+ *        {"swapup",      XK_VoidSymbol, swap,         NULL},
+ *        {"swapdown",    XK_VoidSymbol, swap,         NULL},
  *      },
  *      [1] = {
  *        {"top",         XK_VoidSymbol, move,         NULL},
@@ -156,6 +348,19 @@ void add_modifier(unsigned int modmask)
  *        {"sidebyside",  XK_VoidSymbol, sidebyside,   NULL},
  *        {"maximize",    XK_VoidSymbol, maximize,     NULL},
  *        {"listwindows", XK_VoidSymbol, listwindows,  NULL},
+ *        {"relayout",    XK_VoidSymbol, relayout,     NULL},
+ *        {"savelayout",  XK_VoidSymbol, savelayout,   NULL},
+ *        {"restorelayout", XK_VoidSymbol, restorelayout, NULL},
+ *        {"growsplit",   XK_VoidSymbol, resizesplit,  NULL},
+ *        {"shrinksplit", XK_VoidSymbol, resizesplit,  NULL},
+ *        {"focusleft",   XK_VoidSymbol, focus,        NULL},
+ *        {"focusright",  XK_VoidSymbol, focus,        NULL},
+ *        {"focusup",     XK_VoidSymbol, focus,        NULL},
+ *        {"focusdown",   XK_VoidSymbol, focus,        NULL},
+ *        {"swapleft",    XK_VoidSymbol, swap,         NULL},
+ *        {"swapright",   XK_VoidSymbol, swap,         NULL},
+ *        {"swapup",      XK_VoidSymbol, swap,         NULL},
+ *        {"swapdown",    XK_VoidSymbol, swap,         NULL},
  *      },
  *   }
  * </pre>
@@ -192,15 +397,19 @@ void setup_bindings_data()
  */
 void clear_bindings()
 {
-    int m = 0, i = 0;
+    int m = 0, i = 0, code = 0;
+
+    for(code = 0; code < KEYCODES_LEN; code++) {
+        if(grabbed[code]) {
+            for(i = 0; i < nb_locks; i++)
+                ungrab(code, modifiers | locks[i]);
+            grabbed[code] = false;
+        }
+    }
 
     for(m = 0; m < settings.nb_monitors; m++) {
         for(i = 0; i < MOVESLEN; i++) {
-            if(XK_VoidSymbol != bindings[m][i].keysym) {
-                ungrab(XKeysymToKeycode(display, bindings[m][i].keysym), modifiers);
-                ungrab(XKeysymToKeycode(display, bindings[m][i].keysym), modifiers | Mod2Mask);
-                bindings[m][i].keysym = XK_VoidSymbol;
-            }
+            bindings[m][i].keysym = XK_VoidSymbol;
 
             if(bindings[m][i].data != NULL) {
                 free(bindings[m][i].data);
@@ -239,41 +448,131 @@ void print_key_event(const XKeyEvent event, const bool with_modifiers)
             strcat(keystring, "AltGr + ");
     }
 
-    strcat(keystring, XKeysymToString(XKeycodeToKeysym(event.display, event.keycode, 0)));
+    strcat(keystring, XKeysymToString(XkbKeycodeToKeysym(event.display, event.keycode, 0, 0)));
 
-    printf(COLOR_GREEN "received \"%s\" key press" COLOR_CLEAR "\n", keystring);
+    INFO(("received \"%s\" key press", keystring));
+}
+
+/**
+ * Start listening to focus changes on the root window
+ * The active window is then known without any request when a key is pressed.
+ */
+void track_active_window()
+{
+    active_window_atom = get_atom(event_display, "_NET_ACTIVE_WINDOW");
+    XCALL(X_ONEWAY, "ChangeWindowAttributes", "ROOT_EVENT_MASK", XDefaultRootWindow(event_display),
+          XSelectInput(event_display, XDefaultRootWindow(event_display), ROOT_EVENT_MASK));
+    active_window = get_display_active_window(event_display);
+}
+
+/**
+ * Last known active window, without any request
+ * @note event loop only
+ */
+Window tracked_active_window()
+{
+    return active_window;
+}
+
+/**
+ * Window targeted by an action
+ * Desktop-wide actions are not bound to the active window: a newer grid
+ * supersedes an older one whatever window has the focus.
+ */
+static Window action_target(Move_t move)
+{
+    switch(move) {
+    case GRID:
+    case SIDEBYSIDE:
+    case LISTWINDOWS:
+    case RELAYOUT:
+    case SAVELAYOUT:
+    case RESTORELAYOUT:
+        return None;
+    default:
+        return active_window;
+    }
+}
+
+/**
+ * Queue the action of a binding on its target
+ * @note event loop only
+ */
+void queue_binding(Move_t move)
+{
+    queue_action(move, action_target(move));
 }
 
 /**
  * If received event is a key sequence, loop over all registered key shortcut
- * until we have a match. Call registered callback (if any)
+ * until we have a match. Queue the matching action for the worker thread.
+ *
+ * Runs on the event loop: must not issue any blocking request on the
+ * worker's connection.
  *
  * @param event received event to match with
+ * @see queue_action
  */
 void dispatch(XEvent *event)
 {
-    int i = 0;
+    if(event->type == PropertyNotify) {
+        if(event->xproperty.atom == active_window_atom) {
+            active_window = get_display_active_window(event->xproperty.display);
+            titles_active(active_window);
+            status_active(active_window);
+        } else {
+            autotile_event(event);
+            titles_event(event);
+            status_event(event);
+            ipc_event(event);
+        }
+        record_property(&event->xproperty);
+        return;
+    }
+
+    if(event->type == MapNotify || event->type == UnmapNotify || event->type == DestroyNotify) {
+        /* the root window's: clients selected with CLIENT_EVENT_MASK report theirs */
+        if(event->xany.window == XDefaultRootWindow(event_display))
+            autotile_event(event);
+        return;
+    }
+
+    if(event->type == GenericEvent || event->type == ConfigureNotify) {
+        snap_event(event);
+        if(event->type == ConfigureNotify)
+            ipc_event(event);
+        return;
+    }
+
+    if(event->type == MappingNotify) {
+        XRefreshKeyboardMapping(&event->xmapping);
+        if(event->xmapping.request != MappingPointer)
+            keymap_dirty = true;
+        return;
+    }
+
+    if(event->type == xkb_event_type) {
+        XkbEvent *xkb = (XkbEvent *) event;
+
+        if(xkb->any.xkb_type == XkbMapNotify)
+            XkbRefreshKeyboardMapping(&xkb->map);
+        keymap_dirty = true;
+        return;
+    }
 
     if(event->type == KeyPress) {
         XKeyEvent e = event->xkey;
-        KeySym keysym = XKeycodeToKeysym(e.display, e.keycode, 0);
+        Move_t move = (e.keycode < KEYCODES_LEN) ? keycode_moves[e.keycode] : MOVESLEN;
 
-        int monitor = get_window_monitor(get_active_window());
+        flight_record(FLIGHT_KEY, move, active_window, e.keycode, 0, 0, 0);
+        record_key(move);
 
         if(settings.verbose) {
             print_key_event(e, true);
         }
 
-        for(i = 0; i < MOVESLEN; i++) {
-            if(keysym == bindings[monitor][i].keysym) {
-                if(bindings[monitor][i].callback != NULL) {
-                    bindings[monitor][i].callback(bindings[monitor][i].data);
-                    if(settings.verbose)
-                        printf(" > calling \"%s\"\n", bindings[monitor][i].name);
-                }
-            }
-        }
+        /* same keys on every monitor, the worker picks the right data */
+        if(move != MOVESLEN)
+            queue_binding(move);
     }
 }
-
-
@@ -33,16 +33,31 @@ typedef struct {
     void *data;                 /**< cookie passed to callback function @see compute_geometries_for_monitor */
 } Binding_t;
 
+/** size of the keycode table (keycodes are 8 bits in the core protocol) */
+#define KEYCODES_LEN        256
+
+/** events the event loop selects on client windows (dragged, indexed) */
+#define CLIENT_EVENT_MASK   (StructureNotifyMask | PropertyChangeMask)
+
+/** events the event loop selects on the root window (properties, screen size) */
+#define ROOT_EVENT_MASK     (StructureNotifyMask | PropertyChangeMask)
+
 extern const Binding_t bindings_reference[MOVESLEN];
 extern Binding_t **bindings;
 
-unsigned int modifiers;
+extern unsigned int modifiers;
 
 void setup_bindings_data();
 void clear_bindings();
 void add_binding(Move_t, KeySym);
 void add_modifier(unsigned int);
+void update_grabs();
+void init_keymap();
+void keymap_flush();
 
+void track_active_window();
+Window tracked_active_window();
+void queue_binding(Move_t);
 void dispatch(XEvent *);
 void print_key_event(const XKeyEvent, const bool);
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "arena.h"
+#include "layout.h"
+
+/* mapping of the layout file */
+static void *mapping = NULL;
+static size_t mapping_size = 0;
+static const LayoutHeader_t *header = NULL;
+static const uint32_t *buckets = NULL;
+static const LayoutEntry_t *entries = NULL;
+
+/** FNV-1a */
+uint32_t
+layout_hash(const char *key)
+{
+    uint32_t hash = 2166136261u;
+
+    for(; *key != '\0'; key++)
+        hash = (hash ^ (unsigned char) *key) * 16777619u;
+
+    return hash;
+}
+
+/**
+ * Unmap the layout file
+ */
+void
+unload_layout()
+{
+    if(mapping != NULL)
+        munmap(mapping, mapping_size);
+
+    mapping = NULL;
+    header = NULL;
+    buckets = NULL;
+    entries = NULL;
+}
+
+/**
+ * Map the layout file, if any
+ * A missing or invalid file is the same as an empty layout.
+ */
+void
+load_layout()
+{
+    struct stat st;
+    int fd;
+
+    unload_layout();
+
+    if((fd = open(settings.layout_file, O_RDONLY)) < 0)
+        return;
+
+    if(fstat(fd, &st) < 0 || st.st_size < sizeof(LayoutHeader_t)) {
+        close(fd);
+        return;
+    }
+
+    mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        mapping = NULL;
+        return;
+    }
+    mapping_size = st.st_size;
+
+    header = (const LayoutHeader_t *) mapping;
+    if(header->magic != LAYOUT_MAGIC || header->version != LAYOUT_VERSION
+            || header->nb_buckets == 0 || (header->nb_buckets & (header->nb_buckets - 1)) != 0
+            || mapping_size != sizeof(LayoutHeader_t)
+                               + header->nb_buckets * sizeof(uint32_t)
+                               + header->nb_entries * sizeof(LayoutEntry_t)) {
+        WARN(("ignoring invalid layout file \"%s\"", settings.layout_file));
+        unload_layout();
+        return;
+    }
+
+    buckets = (const uint32_t *)(header + 1);
+    entries = (const LayoutEntry_t *)(buckets + header->nb_buckets);
+
+    D(("layout: %u windows in \"%s\"", header->nb_entries, settings.layout_file));
+}
+
+/**
+ * Number of windows in the mapped layout
+ */
+int
+layout_size()
+{
+    return (header != NULL) ? header->nb_entries : 0;
+}
+
+/**
+ * Find the first saved window with a given key not used yet
+ * @param[in,out] used  one flag per entry (layout_size()), set on the entry found
+ * @return NULL if none left
+ */
+const LayoutEntry_t *
+match_layout(const char *key, unsigned char *used)
+{
+    uint32_t hash = layout_hash(key), i;
+
+    if(header == NULL)
+        return NULL;
+
+    for(i = buckets[hash & (header->nb_buckets - 1)]; i != 0; i = entries[i-1].next) {
+        if(!used[i-1] && entries[i-1].hash == hash && STREQ(entries[i-1].key, key)) {
+            used[i-1] = 1;
+            return &entries[i-1];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Replace the layout file and map the new one
+ *
+ * Entries keep their order within a bucket, so that windows sharing a key
+ * are restored in the order they were saved. The file is written aside
+ * and renamed: a crash never leaves a truncated layout.
+ *
+ * @param[in] saved     entries (hash and next fields are filled here)
+ * @return false if the file could not be written
+ */
+bool
+write_layout(LayoutEntry_t *saved, int size)
+{
+    LayoutHeader_t head = {LAYOUT_MAGIC, LAYOUT_VERSION, 1, size};
+    uint32_t *heads, *tails, slot;
+    char tmp[sizeof(settings.layout_file) + 8];
+    FILE *fd;
+    int i;
+    bool ok;
+
+    /* load factor below 1 */
+    while(head.nb_buckets < size)
+        head.nb_buckets <<= 1;
+
+    heads = (uint32_t *) arena_alloc(head.nb_buckets * sizeof(uint32_t));
+    tails = (uint32_t *) arena_alloc(head.nb_buckets * sizeof(uint32_t));
+    memset(heads, 0, head.nb_buckets * sizeof(uint32_t));
+
+    for(i = 0; i < size; i++) {
+        saved[i].hash = layout_hash(saved[i].key);
+        saved[i].next = 0;
+
+        slot = saved[i].hash & (head.nb_buckets - 1);
+        if(heads[slot] == 0)
+            heads[slot] = i + 1;
+        else
+            saved[tails[slot] - 1].next = i + 1;
+        tails[slot] = i + 1;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", settings.layout_file);
+    if((fd = fopen(tmp, "wb")) == NULL) {
+        WARN(("Unable to write \"%s\"", tmp));
+        return false;
+    }
+
+    ok = fwrite(&head, sizeof(head), 1, fd) == 1
+         && fwrite(heads, sizeof(uint32_t), head.nb_buckets, fd) == head.nb_buckets
+         && (size == 0 || fwrite(saved, sizeof(LayoutEntry_t), size, fd) == size);
+    ok = (fclose(fd) == 0) && ok;
+
+    if(!ok || rename(tmp, settings.layout_file) != 0) {
+        WARN(("Unable to write \"%s\"", settings.layout_file));
+        unlink(tmp);
+        return false;
+    }
+
+    load_layout();
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Layout
+
+  Layout snapshots: <code>savelayout</code> writes where every window is
+  (zone, monitor, desktop, or plain geometry for windows not in a zone)
+  and <code>restorelayout</code> puts the windows back, after a reboot or
+  a crash of the session.
+
+  Windows are identified by <code>WM_CLASS</code> and
+  <code>WM_WINDOW_ROLE</code>: several windows sharing them are restored in
+  the order they were saved.
+
+  The file is a header, a table of hash buckets and a table of fixed size
+  entries, chained per bucket. It is memory-mapped at startup and after
+  each save, restoring only costs a hash lookup per live window. All
+  placements are then applied in one batch.
+  */
+
+#define LAYOUT_MAGIC    0x59414c54  /* "TLAY" */
+#define LAYOUT_VERSION  1
+#define LAYOUT_KEY_LEN  96
+
+/** header of the layout file
+ * @struct LayoutHeader_t
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nb_buckets;    /**< power of two */
+    uint32_t nb_entries;
+} LayoutHeader_t;
+
+/** saved window
+ * @struct LayoutEntry_t
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t next;          /**< next entry of the bucket + 1, 0 if last */
+    char key[LAYOUT_KEY_LEN];   /**< "instance.class/role" */
+    int32_t desktop;
+    int16_t monitor;
+    uint8_t zone;           /**< Move_t, MOVESLEN to use geometry */
+    uint8_t ratio;
+    Geometry_t geometry;
+} LayoutEntry_t;
+
+uint32_t layout_hash(const char *);
+void load_layout();
+void unload_layout();
+int  layout_size();
+const LayoutEntry_t *match_layout(const char *, unsigned char *);
+bool write_layout(LayoutEntry_t *, int);
+
+#endif /* LAYOUT_H */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "worker.h"
+#include "clients.h"
+#include "corrections.h"
+#include "neighbours.h"
+
+/** window of the index */
+typedef struct {
+    Window window;
+    int centre[2];
+} Neighbour_t;
+
+/** lookup in progress */
+typedef struct {
+    int centre[2];          /**< centre of the window looked from */
+    int axis;               /**< 0 for left and right, 1 for up and down */
+    int sign;               /**< -1 towards lower coordinates */
+    Window from;
+    Window best;            /**< None until a window is found */
+    long cost;
+} Query_t;
+
+/* k-d tree: each range is split at its median, on x then y alternately */
+static Neighbour_t entries[NEIGHBOURS_LEN];
+static int nb_entries = 0;
+
+/* what the tree was built from */
+static Window built_from[NEIGHBOURS_LEN];
+static int built_size = -1;
+static int built_desktop = -1;
+static bool dirty = true;
+
+/**
+ * Build the tree again on next lookup
+ */
+void
+invalidate_neighbours()
+{
+    dirty = true;
+}
+
+/**
+ * Follow windows moved or resized by someone else than tiler
+ *
+ * Sizes are always known, positions only from synthetic events (ICCCM
+ * 4.1.5, root coordinates). Events within CORRECTION_MAX of the geometry
+ * tiler asked for are the WM adjusting a placement, the cached geometry
+ * (the one asked for) is kept.
+ * @note worker only
+ */
+void
+track_configure(XConfigureEvent *event)
+{
+    Client_t *client = get_client(event->window);
+    ClientState_t *state = get_state(event->window);
+    Geometry_t *seen, requested = {0, 0, 0, 0};
+
+    if(client == NULL || client->seen.width == 0)
+        return;
+
+    if(state != NULL)
+        requested = state->requested;
+
+    seen = &client->seen;
+    if((abs(event->width - requested.width) > CORRECTION_MAX
+            || abs(event->height - requested.height) > CORRECTION_MAX)
+            && (seen->width != event->width || seen->height != event->height)) {
+        seen->width = event->width;
+        seen->height = event->height;
+        dirty = true;
+    }
+
+    if(event->send_event
+            && (abs(event->x - requested.x) > CORRECTION_MAX
+                || abs(event->y - requested.y) > CORRECTION_MAX)
+            && (seen->x != event->x || seen->y != event->y)) {
+        seen->x = event->x;
+        seen->y = event->y;
+        dirty = true;
+    }
+}
+
+static int
+compare_windows(const void *a, const void *b)
+{
+    Window wa = * (const Window *) a, wb = * (const Window *) b;
+
+    return (wa > wb) - (wa < wb);
+}
+
+static int
+compare_x(const void *a, const void *b)
+{
+    return ((const Neighbour_t *) a)->centre[0] - ((const Neighbour_t *) b)->centre[0];
+}
+
+static int
+compare_y(const void *a, const void *b)
+{
+    return ((const Neighbour_t *) a)->centre[1] - ((const Neighbour_t *) b)->centre[1];
+}
+
+/** Sort a range around its median, and its halves on the other axis */
+static void
+build(int lo, int hi, int depth)
+{
+    int mid = (lo + hi) / 2;
+
+    if(hi - lo <= 1)
+        return;
+
+    qsort(&entries[lo], hi - lo, sizeof(Neighbour_t), (depth % 2) ? compare_y : compare_x);
+    build(lo, mid, depth + 1);
+    build(mid + 1, hi, depth + 1);
+}
+
+/**
+ * Build the tree again if the windows of the current desktop or their
+ * geometries changed since last time
+ */
+static void
+refresh(Display *display)
+{
+    Window *list = NULL;
+    Client_t *client;
+    int desktop, size, i;
+
+    desktop = get_current_desktop(display);
+    size = get_client_list(display, root, &list);
+
+    /* bottom to top: the topmost windows are the ones worth keeping */
+    if(size > NEIGHBOURS_LEN) {
+        list += size - NEIGHBOURS_LEN;
+        size = NEIGHBOURS_LEN;
+    }
+
+    /* stacking order changes with the focus, the set of windows does not */
+    qsort(list, size, sizeof(Window), compare_windows);
+
+    if(!dirty && desktop == built_desktop && size == built_size
+            && memcmp(list, built_from, size * sizeof(Window)) == 0)
+        return;
+
+    nb_entries = 0;
+    for(i = 0; i < size && !action_cancelled(); i++) {
+        client = update_client(display, list[i]);
+
+        if(!client->regular || (client->states & (1 << STATE_HIDDEN))
+                || (!settings.is_compiz && client->desktop != desktop))
+            continue;
+
+        if(client->seen.width == 0)
+            get_window_geometry(display, list[i], &client->seen);
+
+        entries[nb_entries].window = list[i];
+        entries[nb_entries].centre[0] = client->seen.x + client->seen.width / 2;
+        entries[nb_entries].centre[1] = client->seen.y + client->seen.height / 2;
+        nb_entries++;
+    }
+
+    /* try again next time */
+    if(action_cancelled()) {
+        dirty = true;
+        return;
+    }
+
+    build(0, nb_entries, 0);
+
+    memcpy(built_from, list, size * sizeof(Window));
+    built_size = size;
+    built_desktop = desktop;
+    dirty = false;
+
+    D(("Neighbours index: %d windows", nb_entries));
+}
+
+/**
+ * Lower bound of the cost of the windows on one side of a split
+ * @return -1 if none of them is in the direction
+ */
+static long
+side_bound(const Query_t *q, int axis, int split, bool high)
+{
+    long offset = split - q->centre[axis];
+
+    if(axis != q->axis)
+        return NEIGHBOURS_ACROSS * MAX(0, high ? offset : -offset);
+
+    /* side of the split in the direction: at least as far as the split */
+    if(high == (q->sign > 0))
+        return MAX(0, q->sign * offset);
+
+    /* side against it: only if the split itself is in the direction */
+    return (q->sign * offset > 0) ? 0 : -1;
+}
+
+static void
+search(int lo, int hi, int depth, Query_t *q)
+{
+    int mid = (lo + hi) / 2, axis = depth % 2, i;
+    const Neighbour_t *e;
+    long along, across, bound;
+    bool near, high;
+
+    if(lo >= hi)
+        return;
+
+    e = &entries[mid];
+    along = q->sign * (e->centre[q->axis] - q->centre[q->axis]);
+    across = abs(e->centre[1 - q->axis] - q->centre[1 - q->axis]);
+    if(e->window != q->from && along > 0
+            && (q->best == None || along + NEIGHBOURS_ACROSS * across < q->cost)) {
+        q->best = e->window;
+        q->cost = along + NEIGHBOURS_ACROSS * across;
+    }
+
+    /* side of the query first */
+    near = (q->centre[axis] >= e->centre[axis]);
+    for(i = 0; i < 2; i++) {
+        high = (i == 0) ? near : !near;
+        bound = side_bound(q, axis, e->centre[axis], high);
+        if(bound < 0 || (q->best != None && bound >= q->cost))
+            continue;
+
+        if(high)
+            search(mid + 1, hi, depth + 1, q);
+        else
+            search(lo, mid, depth + 1, q);
+    }
+}
+
+/**
+ * Closest window of the current desktop in a direction
+ * @param[in] direction LEFT, RIGHT, TOP or BOTTOM
+ * @return None if there is none, or if the window is not known
+ */
+Window
+find_neighbour(Display *display, Window window, Move_t direction)
+{
+    Query_t q;
+    Client_t *client;
+
+    refresh(display);
+
+    if((client = get_client(window)) == NULL || client->seen.width == 0)
+        return None;
+
+    q.centre[0] = client->seen.x + client->seen.width / 2;
+    q.centre[1] = client->seen.y + client->seen.height / 2;
+    q.axis = (direction == TOP || direction == BOTTOM);
+    q.sign = (direction == LEFT || direction == TOP) ? -1 : 1;
+    q.from = window;
+    q.best = None;
+    q.cost = 0;
+
+    search(0, nb_entries, 0, &q);
+
+    return q.best;
+}
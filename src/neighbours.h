@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef NEIGHBOURS_H
+#define NEIGHBOURS_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+#include "clients.h"
+
+/**
+  @page Neighbours
+
+  Directional bindings (<code>focusleft</code>, <code>swapdown</code>...)
+  look for the closest window in a direction among the windows of the
+  current desktop. Their centres are kept in a k-d tree built from the
+  geometries cached in the client records (where tiler placed the window,
+  or where it was seen moving since, see track_configure()): a lookup is
+  O(log n) and queries no window at all.
+
+  Each lookup reads the stacking list and the current desktop, and the
+  tree is only built again when either of them, or a cached geometry,
+  changed since the last one. Windows never seen before are queried once.
+
+  The closest window is the one minimizing its distance along the direction
+  plus NEIGHBOURS_ACROSS times its offset across it, counted between
+  centres: a window straight to the left wins over a closer one lower down.
+
+  @note the index belongs to the worker thread
+  */
+
+#define NEIGHBOURS_LEN      CLIENTS_LEN
+
+/** weight of the offset across the direction */
+#define NEIGHBOURS_ACROSS   2
+
+void invalidate_neighbours();
+void track_configure(XConfigureEvent *);
+Window find_neighbour(Display *, Window, Move_t);
+
+#endif /* NEIGHBOURS_H */
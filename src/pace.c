@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/sync.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "clients.h"
+#include "worker.h"
+#include "trace.h"
+#include "pace.h"
+
+/** resize waiting for an acknowledgement
+ * @struct Pending_t
+ */
+typedef struct {
+    Window window;
+    Client_t *client;
+    XSyncAlarm alarm;               /**< None if waiting for the timeout only */
+    unsigned long long deadline;    /**< ns */
+} Pending_t;
+
+/** per mode figures
+ * @struct PaceStats_t
+ */
+typedef struct {
+    unsigned long applies;
+    unsigned long windows;
+    unsigned long acknowledged;
+    unsigned long timeouts;
+    unsigned long long settle_ns;   /**< first resize sent to last one settled */
+    unsigned long long max_settle_ns;
+    unsigned long long cpu_ns;      /**< worker CPU time */
+} PaceStats_t;
+
+/* SYNC event base, -1 if the extension is not available */
+static int sync_event_base = -1;
+static Atom protocols_atom = None;
+static Atom sync_request_atom = None;
+
+/* [0]: measure, [1]: paced */
+static PaceStats_t stats[2];
+
+static unsigned long long
+cpu_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long
+value_of(XSyncValue value)
+{
+    return ((unsigned long long) (unsigned int) XSyncValueHigh32(value) << 32) | XSyncValueLow32(value);
+}
+
+/**
+ * Look for the SYNC extension
+ * @note uses <code>display</code>, to be called before the worker starts
+ */
+void
+init_pace()
+{
+    int error_base, major, minor;
+
+    if(settings.pace == PACE_OFF)
+        return;
+
+    protocols_atom = get_atom(display, "WM_PROTOCOLS");
+    sync_request_atom = get_atom(display, "_NET_WM_SYNC_REQUEST");
+
+    if(!XSyncQueryExtension(display, &sync_event_base, &error_base)
+            || !XSyncInitialize(display, &major, &minor)) {
+        WARN(("SYNC extension not available, resizes will be paced by timeout"));
+        sync_event_base = -1;
+        return;
+    }
+
+    INFO(("pacing resizes: %d outstanding, %d ms timeout", settings.pace, settings.pace_timeout));
+}
+
+/**
+ * Sync counter of a client, fetched once
+ * @return None if the client does not support sync requests
+ */
+static XSyncCounter
+get_sync_counter(Display *display, Client_t *client)
+{
+    Atom *protocols = NULL, actual_type;
+    int nb_protocols = 0, actual_format, i;
+    unsigned long nitems = 0, bytes_after;
+    unsigned char *data = NULL;
+    Status status = 0;
+    XSyncValue value;
+    bool supported = false;
+
+    if(client->sync_checked)
+        return client->sync_counter;
+
+    client->sync_checked = true;
+    client->sync_counter = None;
+
+    if(sync_event_base < 0)
+        return None;
+
+    XCALL(X_ROUNDTRIP, "GetProperty", "WM_PROTOCOLS", client->window,
+          status = XGetWMProtocols(display, client->window, &protocols, &nb_protocols));
+    for(i = 0; status && i < nb_protocols; i++)
+        supported |= (protocols[i] == sync_request_atom);
+    if(status)
+        XFree(protocols);
+
+    if(!supported)
+        return None;
+
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_WM_SYNC_REQUEST_COUNTER", client->window,
+          status = XGetWindowProperty(display, client->window,
+                                      get_atom(display, "_NET_WM_SYNC_REQUEST_COUNTER"), 0, 1, 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
+
+    if(status == Success && actual_type == XA_CARDINAL && actual_format == 32 && nitems == 1)
+        client->sync_counter = ((unsigned long *) data)[0];
+    XFree(data);
+
+    if(client->sync_counter == None)
+        return None;
+
+    XCALL(X_ROUNDTRIP, "SyncQueryCounter", NULL, client->window,
+          status = XSyncQueryCounter(display, client->sync_counter, &value));
+    if(!status) {
+        client->sync_counter = None;
+        return None;
+    }
+
+    client->sync_value = value_of(value);
+    return client->sync_counter;
+}
+
+/**
+ * Ask a client to update its counter once it has handled the next resize,
+ * and to be told when it does
+ */
+static XSyncAlarm
+request_sync(Display *display, Client_t *client)
+{
+    XSyncAlarmAttributes attributes;
+    XSyncAlarm alarm = None;
+    XEvent event;
+    unsigned long long value = ++client->sync_value;
+
+    memset(&event, 0, sizeof(event));
+    event.xclient.type = ClientMessage;
+    event.xclient.window = client->window;
+    event.xclient.message_type = protocols_atom;
+    event.xclient.format = 32;
+    event.xclient.data.l[0] = sync_request_atom;
+    event.xclient.data.l[1] = CurrentTime;
+    event.xclient.data.l[2] = value & 0xffffffff;
+    event.xclient.data.l[3] = value >> 32;
+
+    XCALL(X_ONEWAY, "SendEvent", "_NET_WM_SYNC_REQUEST", client->window,
+          XSendEvent(display, client->window, False, NoEventMask, &event));
+
+    attributes.trigger.counter = client->sync_counter;
+    attributes.trigger.value_type = XSyncAbsolute;
+    XSyncIntsToValue(&attributes.trigger.wait_value, value & 0xffffffff, value >> 32);
+    attributes.trigger.test_type = XSyncPositiveComparison;
+    attributes.events = True;
+
+    XCALL(X_ONEWAY, "SyncCreateAlarm", NULL, client->window,
+          alarm = XSyncCreateAlarm(display, XSyncCACounter | XSyncCAValueType | XSyncCAValue
+                                   | XSyncCATestType | XSyncCAEvents, &attributes));
+
+    return alarm;
+}
+
+/** Forget a pending resize, the last one takes its slot */
+static void
+settle(Display *display, Pending_t *pending, int *nb, int i)
+{
+    if(pending[i].alarm != None) {
+        XCALL(X_ONEWAY, "SyncDestroyAlarm", NULL, pending[i].window,
+              XSyncDestroyAlarm(display, pending[i].alarm));
+    }
+
+    pending[i] = pending[--(*nb)];
+}
+
+/**
+ * Wait until at least one pending resize is acknowledged or times out
+ */
+static void
+wait_pending(Display *display, Pending_t *pending, int *nb, PaceStats_t *s)
+{
+    struct pollfd fd = {ConnectionNumber(display), POLLIN, 0};
+    XSyncAlarmNotifyEvent *notify;
+    unsigned long long now, deadline, reached;
+    bool done = false;
+    XEvent event;
+    int i;
+
+    for(;;) {
+        while(sync_event_base >= 0
+                && XCheckTypedEvent(display, sync_event_base + XSyncAlarmNotify, &event)) {
+            notify = (XSyncAlarmNotifyEvent *) &event;
+            for(i = 0; i < *nb && pending[i].alarm != notify->alarm; i++)
+                ;
+            if(i == *nb)
+                continue;
+
+            /* the WM may have moved the counter further */
+            reached = value_of(notify->counter_value);
+            if(pending[i].client->window == pending[i].window && reached > pending[i].client->sync_value)
+                pending[i].client->sync_value = reached;
+
+            settle(display, pending, nb, i);
+            s->acknowledged++;
+            done = true;
+        }
+
+        if(done || *nb == 0)
+            return;
+
+        now = trace_now();
+        for(deadline = pending[0].deadline, i = 1; i < *nb; i++)
+            deadline = MIN(deadline, pending[i].deadline);
+
+        if(deadline <= now) {
+            for(i = *nb - 1; i >= 0; i--) {
+                if(pending[i].deadline <= now) {
+                    settle(display, pending, nb, i);
+                    s->timeouts++;
+                }
+            }
+            return;
+        }
+
+        poll(&fd, 1, (deadline - now) / 1000000 + 1);
+    }
+}
+
+/**
+ * Resize windows, at most <code>settings.pace</code> of them waiting for
+ * their client to acknowledge the new size at the same time
+ * @return number of windows sent, the first ones, fewer if superseded
+ * @see fill_geometries
+ */
+int
+pace_geometries(Display *display, const Window *windows, const Geometry_t *geometries, int size)
+{
+    PaceStats_t *s = &stats[settings.pace == PACE_MEASURE ? 0 : 1];
+    int limit = (settings.pace == PACE_MEASURE) ? PACE_MAX : settings.pace;
+    unsigned long long start = trace_now(), cpu_start = cpu_now(), settle_ns;
+    Pending_t pending[PACE_MAX];
+    Client_t *client;
+    int i, nb = 0;
+
+    if(size == 0)
+        return 0;
+
+    for(i = 0; i < size && !action_cancelled(); i++) {
+        while(nb >= limit)
+            wait_pending(display, pending, &nb, s);
+
+        client = add_client(windows[i]);
+        pending[nb].window = windows[i];
+        pending[nb].client = client;
+        pending[nb].alarm = None;
+        if(get_sync_counter(display, client) != None) {
+            pending[nb].alarm = request_sync(display, client);
+            trace_paced(1);
+        }
+
+        fill_geometry(display, windows[i], geometries[i]);
+        pending[nb++].deadline = trace_now() + settings.pace_timeout * 1000000ULL;
+
+        /* measuring only: everything is sent at once, as when not pacing */
+        if(settings.pace != PACE_MEASURE)
+            XFlush(display);
+    }
+    XFlush(display);
+
+    while(nb > 0 && !action_cancelled())
+        wait_pending(display, pending, &nb, s);
+
+    /* superseded: do not wait for the others */
+    while(nb > 0)
+        settle(display, pending, &nb, nb - 1);
+
+    settle_ns = trace_now() - start;
+    s->applies++;
+    s->windows += i;
+    s->settle_ns += settle_ns;
+    s->max_settle_ns = MAX(s->max_settle_ns, settle_ns);
+    s->cpu_ns += cpu_now() - cpu_start;
+
+    return i;
+}
+
+/**
+ * Print settle and CPU time of measured and paced applies
+ */
+void
+print_pace_stats()
+{
+    static const char * const names[2] = {"fire-and-forget", "paced"};
+    int i;
+
+    if(stats[0].applies == 0 && stats[1].applies == 0)
+        return;
+
+    printf(COLOR_BOLD"Resizes:\n"COLOR_CLEAR);
+    for(i = 0; i < 2; i++) {
+        if(stats[i].applies == 0)
+            continue;
+
+        printf("  - %-16s %lu applies, %lu windows (%lu acknowledged, %lu timed out), "
+               "settle %llu ms mean / %llu ms max, cpu %llu us mean\n",
+               names[i], stats[i].applies, stats[i].windows,
+               stats[i].acknowledged, stats[i].timeouts,
+               stats[i].settle_ns / stats[i].applies / 1000000, stats[i].max_settle_ns / 1000000,
+               stats[i].cpu_ns / stats[i].applies / 1000);
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef PACE_H
+#define PACE_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Pace
+
+  By default fill_geometries() sends every resize at once: a 16 windows
+  relayout floods the WM and the compositor, and clients repaint at
+  intermediate sizes for a while.
+
+  Paced mode (<code>pace = N</code> in the configuration file) keeps at most
+  N resizes outstanding. Clients supporting <code>_NET_WM_SYNC_REQUEST</code>
+  (listed in their <code>WM_PROTOCOLS</code>, with a
+  <code>_NET_WM_SYNC_REQUEST_COUNTER</code>) are sent a sync request before
+  each resize, and a SYNC alarm tells when they have repainted at the new
+  size. Other clients, or clients not answering, are given
+  <code>pace_timeout</code> milliseconds.
+
+  <code>pace = measure</code> sends all resizes at once, as the default mode
+  does, but waits for the acknowledgements afterwards: the settle time and
+  CPU time of both modes can then be compared (SIGUSR1).
+
+  The counter of a window is looked up the first time it is resized (up to
+  PACE_ROUNDTRIPS round trips), each paced resize then costs a few one-way
+  requests: budgets are raised accordingly (see check_budget()).
+  */
+
+#define PACE_OFF        0
+#define PACE_MEASURE    -1
+
+/** outstanding resizes at most */
+#define PACE_MAX        32
+
+/** budget allowance per paced window */
+#define PACE_ROUNDTRIPS 3
+#define PACE_REQUESTS   6
+
+void init_pace();
+int pace_geometries(Display *, const Window *, const Geometry_t *, int);
+void print_pace_stats();
+
+#endif /* PACE_H */
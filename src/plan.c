@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "geometries.h"
+#include "xactions.h"
+#include "trace.h"
+#include "plan.h"
+
+#define PLAN_NAME_LEN 64
+
+/* size hints benchmark: windows per layout, runs averaged */
+#define BENCH_WINDOWS   50
+#define BENCH_RUNS      1000
+
+typedef struct {
+    Geometry_t geometry;
+    char name[PLAN_NAME_LEN];
+    SizeHints_t hints;
+    int monitor;
+    Move_t zone;
+    Geometry_t tile;
+} PlannedWindow_t;
+
+static Geometry_t *docks = NULL;
+static int nb_docks = 0;
+static PlannedWindow_t *windows = NULL;
+static int nb_windows = 0;
+
+/** Append an element to a growing array */
+static void *
+grow(void *array, int size, size_t element)
+{
+    void *grown = realloc(array, (size + 1) * element);
+
+    if(grown == NULL) {
+        WARN(("Could not allocate memory for the plan"));
+        exit(EXIT_FAILURE);
+    }
+
+    return grown;
+}
+
+/**
+ * Read optional size hints after a window name ("inc=7x14 base=4x4 min=20x20")
+ */
+static void
+read_hints(const char *line, SizeHints_t *hints)
+{
+    char key[8];
+    int w, h, n;
+
+    while(sscanf(line, " %7[a-z]=%dx%d%n", key, &w, &h, &n) == 3) {
+        line += n;
+        if(STREQ(key, "inc")) {
+            hints->inc[0] = w;
+            hints->inc[1] = h;
+        } else if(STREQ(key, "base")) {
+            hints->base[0] = w;
+            hints->base[1] = h;
+        } else if(STREQ(key, "min")) {
+            hints->min[0] = w;
+            hints->min[1] = h;
+        }
+    }
+}
+
+/**
+ * Read monitors, docks and windows
+ * @return false if the file could not be read or describes no monitor
+ */
+static bool
+read_plan(const char *filename)
+{
+    FILE *fd;
+    char buffer[256], kind[16];
+    Geometry_t g;
+    int line = 0, n, n2;
+
+    if((fd = fopen(filename, "r")) == NULL) {
+        WARN(("Unable to open \"%s\"", filename));
+        return false;
+    }
+
+    while(fgets(buffer, sizeof(buffer), fd) != NULL) {
+        line++;
+        if(*buffer == '#' || *buffer == '\n')
+            continue;
+
+        if(sscanf(buffer, "%15s %d %d %d %d %n", kind, &g.x, &g.y, &g.width, &g.height, &n) != 5
+                || g.width <= 0 || g.height <= 0) {
+            WARN(("%s:%d: ignoring invalid line", filename, line));
+            continue;
+        }
+
+        if(STREQ(kind, "monitor")) {
+            settings.monitors = grow(settings.monitors, settings.nb_monitors, sizeof(Monitor_t));
+            settings.monitors[settings.nb_monitors].id = settings.nb_monitors;
+            settings.monitors[settings.nb_monitors].infos = g;
+            settings.monitors[settings.nb_monitors].name = NULL;
+            settings.nb_monitors++;
+        } else if(STREQ(kind, "dock")) {
+            docks = grow(docks, nb_docks, sizeof(Geometry_t));
+            docks[nb_docks++] = g;
+        } else if(STREQ(kind, "window")) {
+            windows = grow(windows, nb_windows, sizeof(PlannedWindow_t));
+            memset(&windows[nb_windows], 0, sizeof(PlannedWindow_t));
+            windows[nb_windows].geometry = g;
+            if(sscanf(buffer + n, "%63s %n", windows[nb_windows].name, &n2) == 1
+                    && strchr(windows[nb_windows].name, '=') == NULL)
+                read_hints(buffer + n + n2, &windows[nb_windows].hints);
+            else {
+                windows[nb_windows].name[0] = '\0';
+                read_hints(buffer + n, &windows[nb_windows].hints);
+            }
+            nb_windows++;
+        } else {
+            WARN(("%s:%d: unknown \"%s\"", filename, line, kind));
+        }
+    }
+
+    fclose(fd);
+
+    if(settings.nb_monitors == 0) {
+        WARN(("%s: no monitor described", filename));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Tile windows of each monitor, in the order of the file
+ */
+static void
+plan_placements()
+{
+    Geometry_t *tiles = (Geometry_t *) malloc(MAX(nb_windows, 1) * sizeof(Geometry_t));
+    SizeHints_t *hints = (SizeHints_t *) malloc(MAX(nb_windows, 1) * sizeof(SizeHints_t));
+    int monitor, i, count;
+
+    for(i = 0; i < nb_windows; i++) {
+        windows[i].monitor = get_geometry_monitor(windows[i].geometry);
+        windows[i].zone = get_current_move(windows[i].monitor, windows[i].geometry);
+    }
+
+    for(monitor = 0; monitor < settings.nb_monitors; monitor++) {
+        for(count = 0, i = 0; i < nb_windows; i++) {
+            if(windows[i].monitor == monitor)
+                hints[count++] = windows[i].hints;
+        }
+
+        plan_grid(monitor, count, tiles, NULL);
+        solve_hints(count, hints, tiles);
+
+        for(count = 0, i = 0; i < nb_windows; i++) {
+            if(windows[i].monitor == monitor)
+                windows[i].tile = tiles[count++];
+        }
+    }
+
+    free(tiles);
+    free(hints);
+}
+
+/**
+ * Time grid layouts of BENCH_WINDOWS windows on the first monitor, every
+ * other window having terminal-like size hints
+ * @return mean time of a layout, in ns
+ */
+static unsigned long long
+bench_hints()
+{
+    Geometry_t tiles[BENCH_WINDOWS];
+    SizeHints_t hints[BENCH_WINDOWS];
+    unsigned long long start;
+    int i;
+
+    memset(hints, 0, sizeof(hints));
+    for(i = 0; i < BENCH_WINDOWS; i += 2) {
+        hints[i].inc[0] = 7;
+        hints[i].inc[1] = 14;
+        hints[i].base[0] = hints[i].base[1] = 4;
+    }
+
+    start = trace_now();
+    for(i = 0; i < BENCH_RUNS; i++) {
+        plan_grid(0, BENCH_WINDOWS, tiles, NULL);
+        solve_hints(BENCH_WINDOWS, hints, tiles);
+    }
+
+    return (trace_now() - start) / BENCH_RUNS;
+}
+
+static void
+print_plan()
+{
+    Monitor_t *left, *right;
+    char left_id[8], right_id[8];
+    int i;
+
+    print_geometries();
+
+    printf(COLOR_BOLD"Adjacency:\n"COLOR_CLEAR);
+    for(i = 0; i < settings.nb_monitors; i++) {
+        left  = (Monitor_t *) bindings[i][LEFTSCREEN].data;
+        right = (Monitor_t *) bindings[i][RIGHTSCREEN].data;
+
+        strcpy(left_id, "-");
+        strcpy(right_id, "-");
+        if(left != NULL)
+            snprintf(left_id, sizeof(left_id), "%d", left->id);
+        if(right != NULL)
+            snprintf(right_id, sizeof(right_id), "%d", right->id);
+
+        printf("  - monitor %-8d left %-4s right %s\n", i, left_id, right_id);
+    }
+
+    printf(COLOR_BOLD"Placements:\n"COLOR_CLEAR);
+    for(i = 0; i < nb_windows; i++) {
+        printf("  - %-16s (%d, %d), (%d, %d)\tmonitor %d, zone %-12s tile (%d, %d), (%d, %d)\n",
+               windows[i].name[0] ? windows[i].name : "(unnamed)",
+               windows[i].geometry.x, windows[i].geometry.y,
+               windows[i].geometry.width, windows[i].geometry.height,
+               windows[i].monitor,
+               (windows[i].zone != MOVESLEN) ? bindings_reference[windows[i].zone].name : "-",
+               windows[i].tile.x, windows[i].tile.y, windows[i].tile.width, windows[i].tile.height);
+    }
+}
+
+/**
+ * Planning mode entry point: never connects to X
+ * @return exit status
+ */
+int
+run_plan(const char *filename)
+{
+    unsigned long long start, end;
+    int i;
+
+    if(!read_plan(filename))
+        return EXIT_FAILURE;
+
+    start = trace_now();
+
+    for(i = 0; i < settings.nb_monitors; i++)
+        compute_usable_area(i, docks, nb_docks, &settings.monitors[i].workarea);
+
+    setup_bindings_data();
+    plan_placements();
+
+    end = trace_now();
+
+    print_plan();
+    printf(COLOR_BOLD"Computed"COLOR_CLEAR" %d monitors, %d docks, %d windows in %llu us\n",
+           settings.nb_monitors, nb_docks, nb_windows, (end - start) / 1000);
+    printf(COLOR_BOLD"Solved"COLOR_CLEAR" a grid of %d windows with size hints in %llu ns (mean of %d runs)\n",
+           BENCH_WINDOWS, bench_hints(), BENCH_RUNS);
+
+    clear_bindings();
+    free_config();
+    FREE(docks);
+    FREE(windows);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef PLAN_H
+#define PLAN_H
+
+/**
+  @page Plan
+
+  Planning mode (<code>--plan file</code>): runs the geometry code on a
+  described setup instead of the X server, and prints what tiler would do.
+  Nothing is sent to X, a display is not even needed, which makes it
+  suitable for fuzzing and benchmarking layouts offline.
+
+  The file describes monitors, docks and windows, one per line, as
+  geometries (<code>x y width height</code>):
+
+  @code
+  # two monitors side by side, a panel on top of the first one
+  monitor 0 0 1920 1080
+  monitor 1920 0 1280 1024
+  dock 0 0 1920 24
+  window 0 24 960 1056 xterm inc=7x14 base=4x4
+  window 1920 0 640 512
+  @endcode
+
+  Windows may be given size hints (<code>inc</code>, <code>base</code>,
+  <code>min</code> as <code>WxH</code>) after their name, tiles are then
+  adjusted as by solve_hints().
+
+  Printed: the work area and zone tables of each monitor, the monitors
+  adjacency, and for each window its monitor, the zone it is recognized
+  in (if any) and the tile grid()/auto-tiling would give it, windows being
+  tiled in the order of the file. The time spent computing is printed
+  last, followed by the mean time to lay out a grid of 50 windows, half of
+  them with size hints.
+  */
+
+int run_plan(const char *);
+
+#endif /* PLAN_H */
@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "geometries.h"
+#include "xactions.h"
+#include "worker.h"
+#include "trace.h"
+#include "rules.h"
+#include "pace.h"
+#include "replay.h"
+
+#define REPLAY_NAME_LEN 64
+#define REPLAY_TITLE_LEN 256
+/* a stacking list of a thousand windows fits on a line */
+#define REPLAY_LINE_LEN (16 * 1024)
+
+/* recording */
+static FILE *capture = NULL;
+static unsigned long long record_start = 0;
+static Window *described = NULL;
+static int nb_described = 0;
+static Atom stacking_atom = None;
+static Atom active_atom = None;
+static Atom desktop_atom = None;
+
+/** replayed client window
+ * @struct ReplayWindow_t
+ */
+typedef struct {
+    Window recorded;            /**< id in the capture */
+    Window window;              /**< id of the window created for the replay */
+    Geometry_t geometry;        /**< recorded geometry */
+    unsigned int types;
+    bool mapped;
+} ReplayWindow_t;
+
+/* replaying */
+static ReplayWindow_t *windows = NULL;
+static int nb_windows = 0;
+static unsigned long long *latencies = NULL;
+static int nb_latencies = 0;
+static int nb_over_budget = 0;
+
+/** Append an element to a growing array */
+static void *
+grow(void *array, int size, size_t element)
+{
+    void *grown = realloc(array, (size + 1) * element);
+
+    if(grown == NULL)
+        FATAL(("Could not allocate memory for the replay"));
+
+    return grown;
+}
+
+/** Milliseconds since the recording started */
+static unsigned long
+record_time()
+{
+    return (trace_now() - record_start) / 1000000;
+}
+
+/** Windows of a root list property, to be XFree'd
+ * @param property  name of the property (string literal, traced)
+ */
+static int
+read_root_list(Display *dpy, const char *property, Window **list)
+{
+    Atom atom, actual_type;
+    int actual_format, status;
+    unsigned long nitems = 0, bytes_after;
+    unsigned char *data = NULL;
+
+    atom = get_atom(dpy, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, XDefaultRootWindow(dpy),
+          status = XGetWindowProperty(dpy, XDefaultRootWindow(dpy), atom, 0, (~0L), 0,
+                                      XA_WINDOW, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
+
+    if(status != Success || actual_type != XA_WINDOW || actual_format != 32) {
+        XFree(data);
+        data = NULL;
+        nitems = 0;
+    }
+
+    *list = (Window *) data;
+    return nitems;
+}
+
+/** Write what replaying a window needs to know about it, once */
+static void
+describe_window(Display *dpy, Window window)
+{
+    char instance[REPLAY_NAME_LEN], class[REPLAY_NAME_LEN], title[REPLAY_TITLE_LEN];
+    Geometry_t g;
+    char *c;
+    int i;
+
+    for(i = 0; i < nb_described; i++) {
+        if(described[i] == window)
+            return;
+    }
+    described = grow(described, nb_described, sizeof(Window));
+    described[nb_described++] = window;
+
+    get_window_geometry(dpy, window, &g);
+    get_window_class(dpy, window, instance, class, REPLAY_NAME_LEN);
+    if(!get_window_string(dpy, window, "_NET_WM_NAME", title, sizeof(title)))
+        get_window_string(dpy, window, "WM_NAME", title, sizeof(title));
+
+    /* one line per window, the title goes last */
+    for(c = title; *c != '\0'; c++) {
+        if(*c == '\n')
+            *c = ' ';
+    }
+
+    fprintf(capture, "window 0x%lx %d %d %d %d %d %u %u %s %s %s\n", window,
+            g.x, g.y, g.width, g.height, get_window_desktop(dpy, window),
+            get_window_types(dpy, window), get_window_states(dpy, window),
+            *instance ? instance : "-", *class ? class : "-", title);
+}
+
+/** Write the stacking list, describing the windows not seen yet first */
+static void
+record_clients(Display *dpy)
+{
+    Window *list;
+    int i, n;
+
+    n = read_root_list(dpy, "_NET_CLIENT_LIST_STACKING", &list);
+    for(i = 0; i < n; i++)
+        describe_window(dpy, list[i]);
+
+    fprintf(capture, "clients %lu", record_time());
+    for(i = 0; i < n; i++)
+        fprintf(capture, " 0x%lx", list[i]);
+    fprintf(capture, "\n");
+
+    XFree(list);
+}
+
+/**
+ * Start recording: write monitors and the startup state
+ * @note uses <code>display</code>, to be called before the worker starts
+ */
+void
+start_record(const char *filename)
+{
+    int i;
+
+    if((capture = fopen(filename, "w")) == NULL) {
+        WARN(("Unable to open \"%s\", not recording", filename));
+        return;
+    }
+    setvbuf(capture, NULL, _IOLBF, 0);
+
+    record_start = trace_now();
+    stacking_atom = get_atom(display, "_NET_CLIENT_LIST_STACKING");
+    active_atom = get_atom(display, "_NET_ACTIVE_WINDOW");
+    desktop_atom = get_atom(display, "_NET_CURRENT_DESKTOP");
+
+    fprintf(capture, "# tiler "TILER_VERSION_STR" capture\n");
+    for(i = 0; i < settings.nb_monitors; i++) {
+        fprintf(capture, "monitor %d %d %d %d\n",
+                settings.monitors[i].infos.x, settings.monitors[i].infos.y,
+                settings.monitors[i].infos.width, settings.monitors[i].infos.height);
+    }
+
+    record_clients(display);
+    fprintf(capture, "active 0 0x%lx\n", get_display_active_window(display));
+    fprintf(capture, "desktop 0 %d\n", get_current_desktop(display));
+
+    INFO(("recording to \"%s\"", filename));
+}
+
+void
+stop_record()
+{
+    if(capture != NULL)
+        fclose(capture);
+    capture = NULL;
+    FREE(described);
+    nb_described = 0;
+}
+
+/** Record a binding pressed
+ * @note event loop only
+ */
+void
+record_key(Move_t move)
+{
+    if(capture == NULL || move == MOVESLEN)
+        return;
+
+    fprintf(capture, "key %lu %s\n", record_time(), bindings_reference[move].name);
+}
+
+/** Record a change of the root properties replayed
+ * @note event loop only, to be called once the event has been dispatched
+ */
+void
+record_property(XPropertyEvent *event)
+{
+    if(capture == NULL || event->window != XDefaultRootWindow(event->display))
+        return;
+
+    if(event->atom == stacking_atom)
+        record_clients(event->display);
+    else if(event->atom == active_atom)
+        fprintf(capture, "active %lu 0x%lx\n", record_time(), tracked_active_window());
+    else if(event->atom == desktop_atom)
+        fprintf(capture, "desktop %lu %d\n", record_time(), get_current_desktop(event->display));
+}
+
+/** Window created for a recorded one, NULL if unknown */
+static ReplayWindow_t *
+find_window(Window recorded)
+{
+    int i;
+
+    for(i = 0; i < nb_windows; i++) {
+        if(windows[i].recorded == recorded)
+            return &windows[i];
+    }
+
+    return NULL;
+}
+
+/** Create a recorded window, unmapped until it appears in the stacking list */
+static void
+create_window(Window recorded, Geometry_t g, int desktop, unsigned int types,
+              unsigned int states, char *instance, char *class, char *title)
+{
+    XClassHint hint = {instance, class};
+    ReplayWindow_t *w;
+    long value = desktop;
+
+    if(find_window(recorded) != NULL)
+        return;
+
+    windows = grow(windows, nb_windows, sizeof(ReplayWindow_t));
+    w = &windows[nb_windows++];
+    w->recorded = recorded;
+    w->geometry = g;
+    w->types = types;
+    w->mapped = false;
+
+    w->window = XCreateSimpleWindow(event_display, root, g.x, g.y, g.width, g.height, 0, 0, 0);
+    if(!STREQ(instance, "-"))
+        XSetClassHint(event_display, w->window, &hint);
+    XStoreName(event_display, w->window, title);
+    XChangeProperty(event_display, w->window, get_atom(event_display, "_NET_WM_DESKTOP"),
+                    XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &value, 1);
+    set_window_types(event_display, w->window, types);
+    set_window_states(event_display, w->window, states);
+}
+
+/** Set a root property the way the window manager would */
+static void
+set_root_property(const char *property, Atom type, long *values, int n)
+{
+    XChangeProperty(event_display, root, get_atom(event_display, property),
+                    type, 32, PropModeReplace, (unsigned char *) values, n);
+}
+
+/** Replace the stacking list, mapping the windows listed, unmapping the others */
+static void
+replay_clients(char *ids)
+{
+    long *list = (long *) malloc(MAX(nb_windows, 1) * sizeof(long));
+    ReplayWindow_t *w;
+    Window recorded;
+    int i, n = 0, read;
+
+    for(i = 0; i < nb_windows; i++)
+        windows[i].mapped = false;
+
+    while(n < nb_windows && sscanf(ids, " %lx%n", &recorded, &read) == 1) {
+        ids += read;
+        if((w = find_window(recorded)) == NULL)
+            continue;
+        list[n++] = w->window;
+        w->mapped = true;
+    }
+
+    for(i = 0; i < nb_windows; i++) {
+        if(windows[i].mapped)
+            XMapWindow(event_display, windows[i].window);
+        else
+            XUnmapWindow(event_display, windows[i].window);
+    }
+
+    set_root_property("_NET_CLIENT_LIST_STACKING", XA_WINDOW, list, n);
+    set_root_property("_NET_CLIENT_LIST", XA_WINDOW, list, n);
+    free(list);
+}
+
+/**
+ * Everything tiler does at startup, with monitors and docks from the capture
+ */
+static void
+replay_setup()
+{
+    Geometry_t *docks = (Geometry_t *) malloc(MAX(nb_windows, 1) * sizeof(Geometry_t));
+    int i, nb_docks = 0;
+
+    for(i = 0; i < nb_windows; i++) {
+        if(windows[i].types & (1 << WINDOW_DOCK))
+            docks[nb_docks++] = windows[i].geometry;
+    }
+    for(i = 0; i < settings.nb_monitors; i++)
+        compute_usable_area(i, docks, nb_docks, &settings.monitors[i].workarea);
+    free(docks);
+
+    /* two runs of a capture must start from the same corrections */
+    settings.corrections_file[0] = '\0';
+
+    check_wm_support();
+    setup_bindings_data();
+    parse_conf_file(settings.filename);
+
+    if(settings.verbose)
+        print_geometries();
+
+    track_active_window();
+    init_pace();
+    start_worker();
+}
+
+/** Run a binding alone and print what it cost, and whether it was over budget */
+static void
+replay_key(unsigned long time, char *name)
+{
+    const XCounters_t *counters;
+    unsigned long long start, latency;
+    Move_t move;
+
+    for(move = 0; move < MOVESLEN; move++) {
+        if(STREQ(name, bindings_reference[move].name))
+            break;
+    }
+    if(move == MOVESLEN) {
+        WARN(("unknown binding \"%s\"", name));
+        return;
+    }
+
+    start = trace_now();
+    queue_binding(move);
+    wait_worker();
+    latency = (trace_now() - start) / 1000;
+
+    /* the worker is idle, its counters can be read */
+    counters = get_action_counters();
+    printf("  %8lu ms  %-14s %6llu us  %3lu round trips  %3lu requests  %6llu us in X%s\n",
+           time, name, latency, counters->roundtrips, counters->roundtrips + counters->oneway,
+           counters->x_ns / 1000, counters->over_budget ? "  over budget" : "");
+    nb_over_budget += counters->over_budget;
+
+    latencies = grow(latencies, nb_latencies, sizeof(unsigned long long));
+    latencies[nb_latencies++] = latency;
+}
+
+static int
+compare_latencies(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *) a, y = *(const unsigned long long *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void
+print_summary()
+{
+    unsigned long long sum = 0;
+    int i;
+
+    if(nb_latencies == 0) {
+        printf(COLOR_BOLD"Replayed"COLOR_CLEAR" no action\n");
+        return;
+    }
+
+    qsort(latencies, nb_latencies, sizeof(unsigned long long), compare_latencies);
+    for(i = 0; i < nb_latencies; i++)
+        sum += latencies[i];
+
+    printf(COLOR_BOLD"Replayed"COLOR_CLEAR" %d actions: mean %llu us, median %llu us, 95th %llu us, max %llu us\n",
+           nb_latencies, sum / nb_latencies, latencies[nb_latencies / 2],
+           latencies[(nb_latencies * 95) / 100], latencies[nb_latencies - 1]);
+    if(nb_over_budget > 0)
+        printf(COLOR_BOLD"Over budget:"COLOR_CLEAR" %d actions\n", nb_over_budget);
+    print_stats();
+}
+
+/**
+ * Replay mode entry point
+ * @return exit status, failure if an action went over its budget
+ */
+int
+run_replay(const char *filename)
+{
+    FILE *fd;
+    char buffer[REPLAY_LINE_LEN], kind[16], instance[REPLAY_NAME_LEN], class[REPLAY_NAME_LEN];
+    char title[REPLAY_TITLE_LEN], name[32];
+    bool started = false;
+    unsigned long time;
+    unsigned int types, states;
+    Window recorded;
+    ReplayWindow_t *w;
+    Geometry_t g;
+    XEvent event;
+    int line = 0, desktop, n, m;
+    long value;
+
+    if((fd = fopen(filename, "r")) == NULL) {
+        WARN(("Unable to open \"%s\"", filename));
+        return EXIT_FAILURE;
+    }
+
+    display = XOpenDisplay(NULL);
+    event_display = XOpenDisplay(NULL);
+    if(display == NULL || event_display == NULL) {
+        WARN(("Cannot connect to X server"));
+        fclose(fd);
+        return EXIT_FAILURE;
+    }
+    root = XDefaultRootWindow(display);
+
+    printf(COLOR_BOLD"Replaying"COLOR_CLEAR" \"%s\"\n", filename);
+
+    while(!quitting() && fgets(buffer, sizeof(buffer), fd) != NULL) {
+        line++;
+        if(*buffer == '#' || *buffer == '\n' || sscanf(buffer, "%15s %n", kind, &n) != 1)
+            continue;
+
+        if(STREQ(kind, "monitor")) {
+            if(started || sscanf(buffer + n, "%d %d %d %d", &g.x, &g.y, &g.width, &g.height) != 4) {
+                WARN(("%s:%d: ignoring monitor", filename, line));
+                continue;
+            }
+            settings.monitors = grow(settings.monitors, settings.nb_monitors, sizeof(Monitor_t));
+            settings.monitors[settings.nb_monitors].id = settings.nb_monitors;
+            settings.monitors[settings.nb_monitors].infos = g;
+            settings.monitors[settings.nb_monitors].name = NULL;
+            settings.nb_monitors++;
+            continue;
+        }
+
+        if(STREQ(kind, "window")) {
+            *title = '\0';
+            if(sscanf(buffer + n, "%lx %d %d %d %d %d %u %u %63s %63s %255[^\n]", &recorded,
+                      &g.x, &g.y, &g.width, &g.height, &desktop, &types, &states,
+                      instance, class, title) < 10 || g.width <= 0 || g.height <= 0) {
+                WARN(("%s:%d: ignoring invalid window", filename, line));
+                continue;
+            }
+            create_window(recorded, g, desktop, types, states, instance, class, title);
+            continue;
+        }
+
+        /* first event: the startup state is complete */
+        if(!started) {
+            if(settings.nb_monitors == 0) {
+                WARN(("%s: no monitor recorded", filename));
+                break;
+            }
+            replay_setup();
+            started = true;
+        }
+
+        if(sscanf(buffer + n, "%lu %n", &time, &m) != 1) {
+            WARN(("%s:%d: ignoring invalid line", filename, line));
+            continue;
+        }
+        n += m;
+
+        if(STREQ(kind, "clients")) {
+            replay_clients(buffer + n);
+        } else if(STREQ(kind, "active") && sscanf(buffer + n, "%lx", &recorded) == 1) {
+            value = ((w = find_window(recorded)) != NULL) ? w->window : None;
+            set_root_property("_NET_ACTIVE_WINDOW", XA_WINDOW, &value, 1);
+        } else if(STREQ(kind, "desktop") && sscanf(buffer + n, "%ld", &value) == 1) {
+            set_root_property("_NET_CURRENT_DESKTOP", XA_CARDINAL, &value, 1);
+        } else if(STREQ(kind, "key") && sscanf(buffer + n, "%31s", name) == 1) {
+            replay_key(time, name);
+            continue;
+        } else {
+            WARN(("%s:%d: unknown \"%s\"", filename, line, kind));
+            continue;
+        }
+
+        /* let the event loop see the change, as it would from the WM */
+        XSync(event_display, False);
+        while(XPending(event_display)) {
+            XNextEvent(event_display, &event);
+            dispatch(&event);
+        }
+    }
+
+    fclose(fd);
+
+    if(started) {
+        stop_worker();
+        print_summary();
+        print_pace_stats();
+        clear_bindings();
+    }
+
+    free_config();
+    free_rules();
+    FREE(windows);
+    FREE(latencies);
+    XCloseDisplay(event_display);
+    XCloseDisplay(display);
+
+    return (started && nb_over_budget == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Replay
+
+  Record and replay, to measure a change against the same session rather
+  than against whatever windows happen to be open.
+
+  Recording (<code>--record file</code>) runs tiler as usual and writes
+  the X state seen at startup (monitors, client windows with their
+  geometry, desktop, types, states, class and title, the stacking list,
+  the active window and the current desktop) followed by the stream of
+  bindings pressed and root properties changes, each stamped with the
+  milliseconds since startup:
+
+  @code
+  monitor 0 0 1920 1080
+  window 0x1c00007 0 24 960 1056 0 128 0 xterm XTerm ~
+  clients 0 0x1c00007
+  active 0 0x1c00007
+  desktop 0 0
+  key 2315 grid
+  @endcode
+
+  Replaying (<code>--replay file</code>) needs a server of its own, such as
+  Xvfb, and no window manager: tiler creates the recorded windows and
+  plays the window manager's part for the root properties (stacking list,
+  active window, current desktop). Monitors and docks come from the
+  capture, not from Xinerama. Events are replayed in order as fast as
+  possible and each action is run alone (no coalescing), so two runs of the
+  same capture do the same work. The latency, round trips and requests of
+  every action are printed, then a summary.
+  */
+
+void start_record(const char *);
+void stop_record();
+void record_key(Move_t);
+void record_property(XPropertyEvent *);
+
+int run_replay(const char *);
+
+#endif /* REPLAY_H */
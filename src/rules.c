@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "keybindings.h"
+#include "xactions.h"
+#include "layout.h"
+#include "rules.h"
+
+static Rule_t *rules = NULL;
+static int nb_rules = 0;
+
+/* chains of rules (first, last), by class and for any class */
+static int heads[RULES_BUCKETS], tails[RULES_BUCKETS];
+static int any_head = -1, any_tail = -1;
+
+/**
+ * Next word of a rule, "key=value" or "key=\"quoted value\""
+ * @return NULL at the end of the line
+ */
+static char *
+next_word(char **line)
+{
+    char *word, *p = *line;
+    bool quoted = false;
+
+    while(isspace((unsigned char) *p))
+        p++;
+    if(*p == '\0')
+        return NULL;
+
+    for(word = p; *p != '\0' && (quoted || !isspace((unsigned char) *p)); p++) {
+        if(*p == '"') {
+            memmove(p, p + 1, strlen(p));
+            quoted = !quoted;
+            p--;
+        }
+    }
+
+    if(*p != '\0')
+        *p++ = '\0';
+    *line = p;
+
+    return word;
+}
+
+/** @return mask of the names found in a '|' separated list, 0 if one is unknown */
+static unsigned int
+parse_names(char *list, const char * const *names, int nb_names)
+{
+    unsigned int mask = 0;
+    char *name;
+    int i;
+
+    for(name = strtok(list, "|"); name != NULL; name = strtok(NULL, "|")) {
+        for(i = 0; i < nb_names && !STREQ(name, names[i]); i++)
+            ;
+        if(i == nb_names)
+            return 0;
+        mask |= 1 << i;
+    }
+
+    return mask;
+}
+
+/**
+ * Compile a rule from its configuration line
+ * @param line  value of the "rule" line (modified)
+ * @return false if the rule is invalid (and ignored)
+ */
+bool
+add_rule(char *line)
+{
+    Rule_t rule, *grown;
+    char *word, *value;
+    int i, slot;
+
+    memset(&rule, 0, sizeof(rule));
+    rule.zone = MOVESLEN;
+    rule.monitor = -1;
+    rule.next = -1;
+
+    while((word = next_word(&line)) != NULL) {
+        if((value = strchr(word, '=')) != NULL)
+            *value++ = '\0';
+
+        if(STREQ(word, "ignore"))
+            rule.ignore = true;
+        else if(value == NULL)
+            break;
+        else if(STREQ(word, "class"))
+            snprintf(rule.class, sizeof(rule.class), "%s", value);
+        else if(STREQ(word, "instance"))
+            snprintf(rule.instance, sizeof(rule.instance), "%s", value);
+        else if(STREQ(word, "title")) {
+            if(rule.has_title || regcomp(&rule.title, value, REG_EXTENDED | REG_NOSUB) != 0)
+                break;
+            rule.has_title = true;
+        } else if(STREQ(word, "type")) {
+            if((rule.types = parse_names(value, window_type_names, NB_WINDOW_TYPES)) == 0)
+                break;
+        } else if(STREQ(word, "state")) {
+            if((rule.states = parse_names(value, window_state_names, NB_WINDOW_STATES)) == 0)
+                break;
+        } else if(STREQ(word, "monitor")) {
+            rule.monitor = atoi(value);
+        } else if(STREQ(word, "zone")) {
+            for(i = 0; i < MOVESLEN; i++) {
+                if(STREQ(value, bindings_reference[i].name)
+                        && (bindings_reference[i].callback == move || i == MAXIMIZE))
+                    rule.zone = i;
+            }
+            if(rule.zone == MOVESLEN)
+                break;
+        } else
+            break;
+    }
+
+    if(word != NULL) {
+        WARN(("invalid rule near \"%s\"", word));
+        if(rule.has_title)
+            regfree(&rule.title);
+        return false;
+    }
+
+    if((grown = (Rule_t *) realloc(rules, (nb_rules + 1) * sizeof(Rule_t))) == NULL)
+        FATAL(("Could not allocate memory for rules"));
+    rules = grown;
+
+    if(nb_rules == 0) {
+        for(i = 0; i < RULES_BUCKETS; i++)
+            heads[i] = tails[i] = -1;
+    }
+
+    /* chained in definition order */
+    if(rule.class[0] != '\0') {
+        rule.hash = layout_hash(rule.class);
+        slot = rule.hash % RULES_BUCKETS;
+        if(heads[slot] < 0)
+            heads[slot] = nb_rules;
+        else
+            rules[tails[slot]].next = nb_rules;
+        tails[slot] = nb_rules;
+    } else {
+        if(any_head < 0)
+            any_head = nb_rules;
+        else
+            rules[any_tail].next = nb_rules;
+        any_tail = nb_rules;
+    }
+
+    rules[nb_rules++] = rule;
+    return true;
+}
+
+bool
+has_rules()
+{
+    return nb_rules > 0;
+}
+
+/**
+ * First rule matching a window
+ * @param client    record of the window, types and states already known
+ * @return NULL if none
+ * @note only fetches the class (and the title when needed) of the window
+ */
+const Rule_t *
+match_rules(Display *display, Window window, Client_t *client)
+{
+    char instance[RULE_NAME_LEN], class[RULE_NAME_LEN], title[256];
+    bool title_known = false;
+    uint32_t hash;
+    int by_class, any, i;
+    Rule_t *rule;
+
+    if(nb_rules == 0)
+        return NULL;
+
+    get_window_class(display, window, instance, class, sizeof(class));
+    hash = layout_hash(class);
+
+    /* skip colliding classes of the bucket */
+    for(by_class = heads[hash % RULES_BUCKETS]; by_class >= 0; by_class = rules[by_class].next) {
+        if(rules[by_class].hash == hash && STREQ(rules[by_class].class, class))
+            break;
+    }
+    any = any_head;
+
+    /* merge both chains, by definition order */
+    while(by_class >= 0 || any >= 0) {
+        if(any < 0 || (by_class >= 0 && by_class < any)) {
+            i = by_class;
+            do
+                by_class = rules[by_class].next;
+            while(by_class >= 0 && !(rules[by_class].hash == hash && STREQ(rules[by_class].class, class)));
+        } else {
+            i = any;
+            any = rules[any].next;
+        }
+        rule = &rules[i];
+
+        if(rule->instance[0] != '\0' && !STREQ(rule->instance, instance))
+            continue;
+        if(rule->types != 0 && (rule->types & client->types) == 0)
+            continue;
+        if((rule->states & client->states) != rule->states)
+            continue;
+
+        if(rule->has_title) {
+            if(!title_known) {
+                if(!get_window_string(display, window, "_NET_WM_NAME", title, sizeof(title)))
+                    get_window_string(display, window, "WM_NAME", title, sizeof(title));
+                title_known = true;
+            }
+            if(regexec(&rule->title, title, 0, NULL, 0) != 0)
+                continue;
+        }
+
+        D(("rule %d matches window 0x%lx (%s)", i, window, class));
+        return rule;
+    }
+
+    return NULL;
+}
+
+void
+free_rules()
+{
+    int i;
+
+    for(i = 0; i < nb_rules; i++) {
+        if(rules[i].has_title)
+            regfree(&rules[i].title);
+    }
+
+    FREE(rules);
+    nb_rules = 0;
+    any_head = any_tail = -1;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <regex.h>
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+#include "clients.h"
+
+/**
+  @page Rules
+
+  Rules (<code>rule</code> lines of the configuration file) tell what to do
+  with a window the first time tiler sees it. A rule is a list of
+  conditions and actions, the first matching rule wins:
+
+  @code
+  rule = class=URxvt zone=right monitor=1
+  rule = type=dialog ignore
+  rule = class=Firefox title="- YouTube" zone=maximize
+  @endcode
+
+  Conditions: <code>class</code>, <code>instance</code> (exact
+  WM_CLASS parts), <code>title</code> (extended regular expression),
+  <code>type</code> (any of, separated by '|') and <code>state</code> (all
+  of). Actions: <code>zone</code> (any zone binding, or maximize),
+  <code>monitor</code>, <code>ignore</code> (never tiled). Windows given a
+  zone or ignored are left out of auto-tiling and grid().
+
+  Rules are compiled at load time: rules naming a class are chained in a
+  hash table by class, the others in a separate chain. Matching a window
+  walks both chains for its class only, in definition order, testing
+  types and states as bit masks and running the title expression last,
+  the title being fetched only if a candidate rule needs it.
+  */
+
+#define RULES_BUCKETS   64
+#define RULE_NAME_LEN   64
+
+/** compiled rule
+ * @struct Rule_t
+ */
+typedef struct {
+    /* conditions */
+    char class[RULE_NAME_LEN];      /**< empty: any */
+    char instance[RULE_NAME_LEN];   /**< empty: any */
+    bool has_title;
+    regex_t title;
+    unsigned int types;     /**< any of these types, 0: any */
+    unsigned int states;    /**< all of these states */
+
+    /* actions */
+    bool ignore;
+    Move_t zone;            /**< MOVESLEN: none */
+    int monitor;            /**< -1: none */
+
+    uint32_t hash;
+    int next;               /**< next rule of the chain, -1 if last */
+} Rule_t;
+
+bool add_rule(char *);
+bool has_rules();
+const Rule_t *match_rules(Display *, Window, Client_t *);
+void free_rules();
+
+#endif /* RULES_H */
@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include <X11/Xlib.h>
+#ifdef HAVE_XINPUT2
+#include <X11/extensions/XInput2.h>
+#endif
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "xactions.h"
+#include "worker.h"
+#include "trace.h"
+#include "snap.h"
+
+#ifdef HAVE_XINPUT2
+
+/** hot area of a cell */
+typedef struct {
+    unsigned char zone;     /**< Move_t, MOVESLEN if none */
+    unsigned char monitor;
+} Cell_t;
+
+static int xi_opcode = -1;
+static Atom wm_state = None;
+
+/* hit-testing index */
+static Cell_t *cells = NULL;
+static int cols = 0, rows = 0;
+static int origin_x = 0, origin_y = 0;
+
+/* drag in progress */
+static bool dragging = false;
+static bool wm_moved = false;
+static bool dirty = false;
+static Window dragged = None;
+static int press_x = 0, press_y = 0;
+static int pointer_x = 0, pointer_y = 0;
+
+/* cost of motion handling */
+static unsigned long nb_events = 0, nb_batches = 0;
+static unsigned long long ns_spent = 0;
+
+/* monitor containing a point, -1 if none (unlike get_geometry_monitor()) */
+static int
+monitor_at(int x, int y)
+{
+    int i;
+
+    for(i = 0; i < settings.nb_monitors; i++) {
+        Geometry_t m = settings.monitors[i].infos;
+        if(x >= m.x && x < m.x + m.width && y >= m.y && y < m.y + m.height)
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Hot area of a point: outer edges of its monitor (edges shared with another
+ * monitor are crossed, not hit), corners extending SNAP_CORNER cells
+ */
+static Move_t
+hot_zone(int x, int y, int monitor)
+{
+    Geometry_t m = settings.monitors[monitor].infos;
+    int corner = SNAP_CELL * SNAP_CORNER;
+
+    bool left   = (x - m.x < SNAP_CELL) && monitor_at(m.x - 1, y) < 0;
+    bool right  = (m.x + m.width - x <= SNAP_CELL) && monitor_at(m.x + m.width, y) < 0;
+    bool top    = (y - m.y < SNAP_CELL) && monitor_at(x, m.y - 1) < 0;
+    bool bottom = (m.y + m.height - y <= SNAP_CELL) && monitor_at(x, m.y + m.height) < 0;
+
+    bool near_left   = (x - m.x < corner);
+    bool near_right  = (m.x + m.width - x <= corner);
+    bool near_top    = (y - m.y < corner);
+    bool near_bottom = (m.y + m.height - y <= corner);
+
+    if((top && near_left) || (left && near_top))
+        return TOPLEFT;
+    if((top && near_right) || (right && near_top))
+        return TOPRIGHT;
+    if((bottom && near_left) || (left && near_bottom))
+        return BOTTOMLEFT;
+    if((bottom && near_right) || (right && near_bottom))
+        return BOTTOMRIGHT;
+    if(top)
+        return TOP;
+    if(bottom)
+        return BOTTOM;
+    if(left)
+        return LEFT;
+    if(right)
+        return RIGHT;
+
+    return MOVESLEN;
+}
+
+/* precompute hot areas over the bounding box of all monitors */
+static void
+build_index()
+{
+    int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
+    int i, c, r;
+
+    for(i = 0; i < settings.nb_monitors; i++) {
+        Geometry_t m = settings.monitors[i].infos;
+        x_min = MIN(x_min, m.x);
+        y_min = MIN(y_min, m.y);
+        x_max = MAX(x_max, m.x + m.width);
+        y_max = MAX(y_max, m.y + m.height);
+    }
+
+    origin_x = x_min;
+    origin_y = y_min;
+    cols = (x_max - x_min + SNAP_CELL - 1) / SNAP_CELL;
+    rows = (y_max - y_min + SNAP_CELL - 1) / SNAP_CELL;
+
+    FREE(cells);
+    if((cells = malloc(cols * rows * sizeof(Cell_t))) == NULL)
+        FATAL(("Could not allocate snap index"));
+
+    for(r = 0; r < rows; r++) {
+        for(c = 0; c < cols; c++) {
+            Cell_t *cell = &cells[r * cols + c];
+            int x = origin_x + c * SNAP_CELL + SNAP_CELL / 2;
+            int y = origin_y + r * SNAP_CELL + SNAP_CELL / 2;
+            int monitor = monitor_at(x, y);
+
+            cell->monitor = (monitor < 0) ? 0 : monitor;
+            cell->zone = (monitor < 0) ? MOVESLEN : hot_zone(x, y, monitor);
+        }
+    }
+
+    D(("snap index: %dx%d cells of %dpx", cols, rows, SNAP_CELL));
+}
+
+static Cell_t *
+hit_test(int x, int y)
+{
+    int c = (x - origin_x) / SNAP_CELL;
+    int r = (y - origin_y) / SNAP_CELL;
+
+    if(x < origin_x || y < origin_y || c >= cols || r >= rows)
+        return NULL;
+
+    return &cells[r * cols + c];
+}
+
+/** Update the pointer position
+ * @return top-level window under the pointer (frame of a reparenting WM)
+ */
+static Window
+query_pointer()
+{
+    Window root_return, child = None;
+    int win_x, win_y;
+    unsigned int mask;
+
+    XCALL(X_ROUNDTRIP, "QueryPointer", NULL, None,
+          XQueryPointer(event_display, XDefaultRootWindow(event_display), &root_return, &child,
+                        &pointer_x, &pointer_y, &win_x, &win_y, &mask));
+    dirty = false;
+    nb_batches++;
+
+    return child;
+}
+
+/** Client window in a top-level window: the first one with WM_STATE, looked
+ * for at most depth levels below
+ * @return None if not found
+ */
+static Window
+find_client(Window window, int depth)
+{
+    Window root_return, parent, *children = NULL, found = None;
+    unsigned int nb_children = 0, i;
+    Atom type = None;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data = NULL;
+    Status status = 0;
+
+    XCALL(X_ROUNDTRIP, "GetProperty", "WM_STATE", window,
+          XGetWindowProperty(event_display, window, wm_state, 0, 0, False, AnyPropertyType,
+                             &type, &format, &nitems, &bytes_after, &data));
+    XFree(data);
+    if(type != None)
+        return window;
+    if(depth == 0)
+        return None;
+
+    XCALL(X_ROUNDTRIP, "QueryTree", NULL, window,
+          status = XQueryTree(event_display, window, &root_return, &parent, &children, &nb_children));
+    for(i = 0; status != 0 && i < nb_children && found == None; i++)
+        found = find_client(children[i], depth - 1);
+    XFree(children);
+
+    return found;
+}
+
+static void
+end_drag()
+{
+    Cell_t *cell;
+    int travel = abs(pointer_x - press_x) + abs(pointer_y - press_y);
+
+    dragging = false;
+
+    if(!wm_moved || travel < SNAP_THRESHOLD || dragged == None)
+        return;
+
+    if((cell = hit_test(pointer_x, pointer_y)) == NULL || cell->zone == MOVESLEN)
+        return;
+
+    INFO(("snapping 0x%lx to \"%s\" on monitor %d", dragged, bindings_reference[cell->zone].name, cell->monitor));
+    queue_action_on((Move_t) cell->zone, dragged, cell->monitor);
+}
+
+/**
+ * Start watching pointer activity, if enabled and available
+ * @pre monitors configuration is known
+ */
+void
+init_snap()
+{
+    int event, error, major = 2, minor = 2;
+    unsigned char mask[XIMaskLen(XI_RawMotion)] = {0};
+    XIEventMask event_mask;
+
+    if(!settings.snap)
+        return;
+
+    if(!XQueryExtension(event_display, "XInputExtension", &xi_opcode, &event, &error)
+            || XIQueryVersion(event_display, &major, &minor) != Success) {
+        WARN(("XInput 2 not available, drag-to-snap disabled"));
+        settings.snap = false;
+        return;
+    }
+
+    /* before 2.1, raw events stop while another client (the WM moving a
+     * window) grabs the pointer */
+    if(major < 2 || (major == 2 && minor < 1)) {
+        WARN(("XInput %d.%d too old (2.1 needed), drag-to-snap disabled", major, minor));
+        settings.snap = false;
+        return;
+    }
+
+    wm_state = get_atom(event_display, "WM_STATE");
+    build_index();
+
+    XISetMask(mask, XI_RawButtonPress);
+    XISetMask(mask, XI_RawButtonRelease);
+    XISetMask(mask, XI_RawMotion);
+
+    event_mask.deviceid = XIAllMasterDevices;
+    event_mask.mask_len = sizeof(mask);
+    event_mask.mask = mask;
+
+    XCALL(X_ONEWAY, "XISelectEvents", "RawMotion", XDefaultRootWindow(event_display),
+          XISelectEvents(event_display, XDefaultRootWindow(event_display), &event_mask, 1));
+}
+
+/**
+ * Handle pointer events (and WM moves of the dragged window)
+ * Motion events only flag the position as outdated, see snap_flush().
+ */
+void
+snap_event(XEvent *event)
+{
+    unsigned long long start;
+
+    if(!settings.snap)
+        return;
+
+    start = trace_now();
+
+    if(event->type == ConfigureNotify) {
+        if(dragging && event->xconfigure.window == dragged)
+            wm_moved = true;
+        return;
+    }
+
+    XGenericEventCookie *cookie = &event->xcookie;
+    if(event->type != GenericEvent || cookie->extension != xi_opcode
+            || !XGetEventData(event_display, cookie))
+        return;
+
+    XIRawEvent *raw = (XIRawEvent *) cookie->data;
+
+    switch(cookie->evtype) {
+    case XI_RawMotion:
+        nb_events++;
+        dirty = dragging;
+        break;
+
+    case XI_RawButtonPress:
+        if(raw->detail != Button1)
+            break;
+
+        /* what is under the pointer: click-to-focus has not switched the
+         * active window yet */
+        dragging = true;
+        wm_moved = false;
+        dragged = find_client(query_pointer(), SNAP_CLIENT_DEPTH);
+        press_x = pointer_x;
+        press_y = pointer_y;
+
+        /* the WM notifies the client of frame moves (ICCCM synthetic ConfigureNotify) */
+        if(dragged != None)
+            XCALL(X_ONEWAY, "ChangeWindowAttributes", "CLIENT_EVENT_MASK", dragged,
+                  XSelectInput(event_display, dragged, CLIENT_EVENT_MASK));
+        break;
+
+    case XI_RawButtonRelease:
+        if(raw->detail != Button1 || !dragging)
+            break;
+
+        query_pointer();
+        end_drag();
+        break;
+    }
+
+    XFreeEventData(event_display, cookie);
+    ns_spent += trace_now() - start;
+}
+
+/**
+ * Refresh the pointer position once for a whole batch of motion events
+ * To be called once the event queue has been drained.
+ */
+void
+snap_flush()
+{
+    if(!settings.snap || !dirty)
+        return;
+
+    unsigned long long start = trace_now();
+    query_pointer();
+    ns_spent += trace_now() - start;
+}
+
+/**
+ * Print motion handling costs
+ */
+void
+print_snap_stats()
+{
+    if(!settings.snap)
+        return;
+
+    printf(COLOR_BOLD"Drag-to-snap:\n"COLOR_CLEAR
+           "  - raw motion events  %lu\n"
+           "  - pointer queries    %lu\n"
+           "  - time per event     %.1f ns\n",
+           nb_events, nb_batches,
+           (double) ns_spent / (nb_events > 0 ? nb_events : 1));
+}
+
+#else /* HAVE_XINPUT2 */
+
+void
+init_snap()
+{
+    if(settings.snap) {
+        WARN(("built without XInput 2, drag-to-snap disabled"));
+        settings.snap = false;
+    }
+}
+
+void snap_event(XEvent *event) {}
+void snap_flush() {}
+void print_snap_stats() {}
+
+#endif /* HAVE_XINPUT2 */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SNAP_H
+#define SNAP_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Snap
+
+  Drag-to-snap (<code>--snap</code>): dropping a window moved by the WM on an
+  outer edge or corner of a monitor places it in the matching zone, the way
+  WinSplit or Aero do.
+
+  @li pointer activity is watched through XInput 2 raw events on the root
+      window, which are delivered whatever window is under the pointer,
+      even while the WM grabs it (XInput 2.1 and later)
+  @li the window dragged is the client under the pointer when button 1 is
+      pressed, and its move is considered WM-driven once it receives a
+      ConfigureNotify while the button is held
+  @li raw motion events only mark the pointer as moved: the position is
+      queried once per batch of events (snap_flush()), so a 1000 Hz mouse
+      costs one query per event loop iteration, not one per event
+  @li hot areas of all monitors are precomputed in a grid of SNAP_CELL
+      pixels cells: hit-testing the pointer is a single lookup
+
+  Needs tiler to be built with XInput 2 support (XINPUT2 = 1 in Makefile).
+  */
+
+/** size of the index cells, also the thickness of the hot edges */
+#define SNAP_CELL       16
+/** corners extend over that many cells along each edge */
+#define SNAP_CORNER     4
+/** pointer travel (pixels) below which a release is just a click */
+#define SNAP_THRESHOLD  24
+/** levels of WM frames looked into for the client window under the pointer */
+#define SNAP_CLIENT_DEPTH 3
+
+void init_snap();
+void snap_event(XEvent *);
+void snap_flush();
+void print_snap_stats();
+
+#endif /* SNAP_H */
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "clients.h"
+#include "arena.h"
+#include "splits.h"
+
+/** tree of a desktop and monitor */
+typedef struct {
+    int desktop;
+    int monitor;
+    int root;               /**< -1 if the slot is free */
+} SplitTree_t;
+
+static SplitNode_t nodes[SPLIT_NODES_LEN];
+static int free_nodes = -1;
+static int nb_used = 0;
+
+static SplitTree_t trees[SPLIT_TREES_LEN];
+static int nb_trees = 0;
+
+static int
+new_node(int parent)
+{
+    int n;
+
+    if(free_nodes >= 0) {
+        n = free_nodes;
+        free_nodes = nodes[n].children[0];
+    } else if(nb_used < SPLIT_NODES_LEN) {
+        n = nb_used++;
+    } else {
+        return -1;
+    }
+
+    memset(&nodes[n], 0, sizeof(SplitNode_t));
+    nodes[n].parent = parent;
+    nodes[n].children[0] = nodes[n].children[1] = -1;
+    nodes[n].ratio = 500;
+
+    return n;
+}
+
+static void
+free_tree(int n)
+{
+    if(n < 0)
+        return;
+
+    free_tree(nodes[n].children[0]);
+    free_tree(nodes[n].children[1]);
+
+    nodes[n].window = None;
+    nodes[n].children[0] = free_nodes;
+    free_nodes = n;
+}
+
+/** Tree slot of a desktop and monitor, a free (or the oldest) one if none */
+static SplitTree_t *
+get_tree(int desktop, int monitor)
+{
+    int i;
+
+    for(i = 0; i < nb_trees; i++) {
+        if(trees[i].desktop == desktop && trees[i].monitor == monitor)
+            return &trees[i];
+    }
+
+    for(i = 0; i < nb_trees && trees[i].root >= 0; i++)
+        ;
+    if(i == SPLIT_TREES_LEN) {
+        /* full: drop the first one, trees are rebuilt on the next grid anyway */
+        free_tree(trees[0].root);
+        i = 0;
+    } else if(i == nb_trees) {
+        nb_trees++;
+    }
+
+    trees[i].desktop = desktop;
+    trees[i].monitor = monitor;
+    trees[i].root = -1;
+
+    return &trees[i];
+}
+
+/**
+ * Find the cut line of a set of tiles the closest to the middle of the area
+ * @return position of the cut, -1 if tiles cannot be split along this axis
+ */
+static int
+find_cut(const Geometry_t *tiles, const int *set, int n, Geometry_t area, bool stacked)
+{
+    int i, j, cut, best = -1, start = stacked ? area.y : area.x;
+    int middle = start + (stacked ? area.height : area.width) / 2;
+
+    for(i = 0; i < n; i++) {
+        cut = stacked ? tiles[set[i]].y : tiles[set[i]].x;
+        if(cut <= start)
+            continue;
+
+        for(j = 0; j < n; j++) {
+            const Geometry_t *t = &tiles[set[j]];
+            int from = stacked ? t->y : t->x, to = from + (stacked ? t->height : t->width);
+
+            if(from < cut && to > cut)
+                break;
+        }
+
+        if(j == n && (best < 0 || abs(cut - middle) < abs(best - middle)))
+            best = cut;
+    }
+
+    return best;
+}
+
+/** Build the subtree of a set of tiles covering an area
+ * @return root of the subtree, -1 if out of nodes
+ */
+static int
+build(const Window *windows, const Geometry_t *tiles, int *set, int n, Geometry_t area, int parent)
+{
+    int node = new_node(parent), cut, i, nb_first = 0, length;
+    int *second;
+    bool stacked = false;
+    Geometry_t first_area, second_area;
+
+    if(node < 0)
+        return -1;
+
+    nodes[node].geometry = area;
+
+    if(n == 1) {
+        nodes[node].window = windows[set[0]];
+        add_state(windows[set[0]])->split_leaf = node + 1;
+        return node;
+    }
+
+    /* cut the longer way first, as grid layouts do */
+    stacked = (area.height > area.width);
+    if((cut = find_cut(tiles, set, n, area, stacked)) < 0) {
+        stacked = !stacked;
+        cut = find_cut(tiles, set, n, area, stacked);
+    }
+
+    second = (int *) arena_alloc(n * sizeof(int));
+    if(cut >= 0) {
+        /* tiles before the cut first */
+        for(i = 0; i < n; i++) {
+            if((stacked ? tiles[set[i]].y : tiles[set[i]].x) < cut)
+                set[nb_first++] = set[i];
+            else
+                second[i - nb_first] = set[i];
+        }
+    } else {
+        /* not a guillotine layout: split the list in halves */
+        nb_first = n / 2;
+        cut = (stacked ? area.y + area.height / 2 : area.x + area.width / 2);
+        for(i = nb_first; i < n; i++)
+            second[i - nb_first] = set[i];
+    }
+
+    length = stacked ? area.height : area.width;
+    nodes[node].stacked = stacked;
+    nodes[node].ratio = (int) ((long long) (cut - (stacked ? area.y : area.x)) * 1000 / MAX(length, 1));
+
+    first_area = second_area = area;
+    if(stacked) {
+        first_area.height = cut - area.y;
+        second_area.y = cut;
+        second_area.height = area.y + area.height - cut;
+    } else {
+        first_area.width = cut - area.x;
+        second_area.x = cut;
+        second_area.width = area.x + area.width - cut;
+    }
+
+    nodes[node].children[0] = build(windows, tiles, set, nb_first, first_area, node);
+    nodes[node].children[1] = build(windows, tiles, second, n - nb_first, second_area, node);
+
+    return node;
+}
+
+/**
+ * Replace the tree of a desktop and monitor with one matching the tiles
+ * of the windows (as laid out by plan_grid())
+ * @note worker only, working sets come from the arena
+ */
+void
+build_split_tree(int desktop, int monitor, const Window *windows, const Geometry_t *tiles, int n)
+{
+    SplitTree_t *tree = get_tree(desktop, monitor);
+    Geometry_t area;
+    int *set, i, right, bottom;
+
+    free_tree(tree->root);
+    tree->root = -1;
+
+    if(n <= 0)
+        return;
+
+    set = (int *) arena_alloc(n * sizeof(int));
+    area = tiles[0];
+    right = area.x + area.width;
+    bottom = area.y + area.height;
+    for(i = 0; i < n; i++) {
+        set[i] = i;
+        area.x = MIN(area.x, tiles[i].x);
+        area.y = MIN(area.y, tiles[i].y);
+        right = MAX(right, tiles[i].x + tiles[i].width);
+        bottom = MAX(bottom, tiles[i].y + tiles[i].height);
+    }
+    area.width = right - area.x;
+    area.height = bottom - area.y;
+
+    tree->root = build(windows, tiles, set, n, area, -1);
+}
+
+/** Compute the areas of a subtree, and list its windows */
+static int
+layout(int n, Geometry_t area, Window *windows, Geometry_t *geometries, int count)
+{
+    SplitNode_t *node = &nodes[n];
+    Geometry_t first = area, second = area;
+
+    node->geometry = area;
+
+    if(node->children[0] < 0) {
+        /* out of nodes while building */
+        if(node->window == None)
+            return count;
+        windows[count] = node->window;
+        geometries[count] = area;
+        return count + 1;
+    }
+
+    if(node->stacked) {
+        first.height = (int) ((long long) area.height * node->ratio / 1000);
+        second.y = area.y + first.height;
+        second.height = area.height - first.height;
+    } else {
+        first.width = (int) ((long long) area.width * node->ratio / 1000);
+        second.x = area.x + first.width;
+        second.width = area.width - first.width;
+    }
+
+    count = layout(node->children[0], first, windows, geometries, count);
+    return layout(node->children[1], second, windows, geometries, count);
+}
+
+/** Leaf of a window, -1 if not in a tree */
+static int
+find_leaf(Window window)
+{
+    ClientState_t *state = get_state(window);
+    int n;
+
+    if(state == NULL || state->split_leaf == 0)
+        return -1;
+
+    n = state->split_leaf - 1;
+    if(nodes[n].window != window || nodes[n].children[0] >= 0)
+        return -1;
+
+    return n;
+}
+
+/**
+ * Grow (steps > 0) or shrink the side of a window in the split above it
+ *
+ * @param[out]  windows, geometries     windows under the split and their new
+ *                                      geometry, room for SPLIT_NODES_LEN entries
+ * @return number of windows to move
+ */
+int
+resize_split(Window window, int steps, Window *windows, Geometry_t *geometries)
+{
+    int leaf = find_leaf(window), split, ratio;
+
+    if(leaf < 0 || (split = nodes[leaf].parent) < 0)
+        return 0;
+
+    /* the first child grows with the ratio, the second one shrinks */
+    if(nodes[split].children[1] == leaf)
+        steps = -steps;
+
+    ratio = nodes[split].ratio + steps * SPLIT_STEP;
+    ratio = MAX(SPLIT_MIN, MIN(1000 - SPLIT_MIN, ratio));
+    if(ratio == nodes[split].ratio)
+        return 0;
+    nodes[split].ratio = ratio;
+
+    return layout(split, nodes[split].geometry, windows, geometries, 0);
+}
+
+/**
+ * Forget the leaf of a window placed by other means: its split is not
+ * resized along with its former neighbours anymore
+ */
+void
+forget_split(Window window)
+{
+    ClientState_t *state = get_state(window);
+
+    if(state != NULL)
+        state->split_leaf = 0;
+}
+
+/**
+ * Exchange the leaves of two windows which swapped places
+ */
+void
+swap_splits(Window a, Window b)
+{
+    int la = find_leaf(a), lb = find_leaf(b);
+
+    if(la < 0 && lb < 0)
+        return;
+
+    if(la >= 0)
+        nodes[la].window = b;
+    if(lb >= 0)
+        nodes[lb].window = a;
+
+    add_state(a)->split_leaf = lb + 1;
+    add_state(b)->split_leaf = la + 1;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef SPLITS_H
+#define SPLITS_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Splits
+
+  Tiled windows of each desktop and monitor are kept in a binary split
+  tree: leaves are windows, inner nodes split their area in two, side by
+  side or one above the other, at a given ratio. The tree is built from
+  the tiles of grid() and relayout() (finding the cut lines of their
+  layout), then <code>growsplit</code> and <code>shrinksplit</code> move the
+  split above the active window. Only the windows under that split are
+  computed again and moved, in one batch.
+
+  Nodes come from a fixed pool and each client record points to its leaf,
+  so finding the split of a window is O(1) and resizing it is
+  O(leaves under the split).
+
+  @note the trees belong to the worker thread
+  */
+
+#define SPLIT_NODES_LEN 1024
+#define SPLIT_TREES_LEN 64
+
+/** ratios are in per mille of the area split */
+#define SPLIT_STEP      50
+#define SPLIT_MIN       100
+
+/** node of a split tree
+ * @struct SplitNode_t
+ */
+typedef struct {
+    int parent;             /**< -1 for the root */
+    int children[2];        /**< -1 for leaves, next free node in the pool */
+    Window window;          /**< leaves only */
+    bool stacked;           /**< children one above the other rather than side by side */
+    int ratio;              /**< share of the first child, per mille */
+    Geometry_t geometry;    /**< area of the node */
+} SplitNode_t;
+
+void build_split_tree(int, int, const Window *, const Geometry_t *, int);
+int resize_split(Window, int, Window *, Geometry_t *);
+void forget_split(Window);
+void swap_splits(Window, Window);
+
+#endif /* SPLITS_H */
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "keybindings.h"
+#include "clients.h"
+#include "titles.h"
+#include "trace.h"
+#include "status.h"
+
+static StatusPage_t *page = NULL;
+
+/* the event loop and the worker both write */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static Atom client_list_atom = None, current_desktop_atom, nb_desktops_atom, desktop_atom;
+
+static void
+begin_write()
+{
+    pthread_mutex_lock(&lock);
+    __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void
+end_write()
+{
+    page->updated = trace_now();
+    __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&lock);
+}
+
+/** Zone and monitor of the active window, from the windows placed */
+static void
+find_active()
+{
+    int i;
+
+    page->active_monitor = -1;
+    page->active_zone = -1;
+
+    for(i = 0; i < page->nb_windows; i++) {
+        if(page->windows[i].window == page->active_window) {
+            page->active_monitor = page->windows[i].monitor;
+            page->active_zone = page->windows[i].zone;
+            break;
+        }
+    }
+}
+
+static void
+write_monitors()
+{
+    int i;
+
+    page->nb_monitors = MIN(settings.nb_monitors, STATUS_MONITORS);
+    for(i = 0; i < page->nb_monitors; i++) {
+        Geometry_t *m = &settings.monitors[i].infos, *w = &settings.monitors[i].workarea;
+        StatusRect_t monitor = {m->x, m->y, m->width, m->height};
+        StatusRect_t workarea = {w->x, w->y, w->width, w->height};
+
+        page->monitors[i] = monitor;
+        page->workareas[i] = workarea;
+    }
+}
+
+/** Current desktop and number of desktops
+ * @note round trips: to be called before begin_write(), never under the lock
+ */
+static void
+read_desktops(int *current, int *nb)
+{
+    *current = get_current_desktop(event_display);
+    *nb = MAX(0, MIN(get_nb_desktop(event_display), STATUS_DESKTOPS));
+}
+
+/** Windows per desktop, from the event loop's index */
+static void
+write_desktops()
+{
+    int counts[STATUS_DESKTOPS];
+
+    count_desktops(counts, STATUS_DESKTOPS);
+    memcpy(page->desktop_windows, counts, sizeof(counts));
+}
+
+/**
+ * Create the status page
+ * @note does nothing if the page is disabled, to be called once the
+ * windows are indexed (see init_titles())
+ */
+void
+init_status()
+{
+    int fd, i, current, nb;
+
+    if(settings.status_file[0] == '\0')
+        return;
+
+    if((fd = open(settings.status_file, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0
+            || ftruncate(fd, sizeof(StatusPage_t)) < 0
+            || (page = (StatusPage_t *) mmap(NULL, sizeof(StatusPage_t), PROT_READ | PROT_WRITE,
+                                              MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        WARN(("cannot map \"%s\": %s", settings.status_file, strerror(errno)));
+        page = NULL;
+        if(fd >= 0)
+            close(fd);
+        return;
+    }
+    close(fd);
+
+    client_list_atom = get_atom(event_display, "_NET_CLIENT_LIST");
+    current_desktop_atom = get_atom(event_display, "_NET_CURRENT_DESKTOP");
+    nb_desktops_atom = get_atom(event_display, "_NET_NUMBER_OF_DESKTOPS");
+    desktop_atom = get_atom(event_display, "_NET_WM_DESKTOP");
+    read_desktops(&current, &nb);
+
+    begin_write();
+    page->magic = STATUS_MAGIC;
+    page->version = STATUS_VERSION;
+    page->size = sizeof(StatusPage_t);
+    page->pid = getpid();
+    page->last_action = -1;
+    for(i = 0; i < MOVESLEN && i < STATUS_MOVES; i++)
+        snprintf(page->names[i], STATUS_NAME_LEN, "%s", bindings_reference[i].name);
+    write_monitors();
+    page->current_desktop = current;
+    page->nb_desktops = nb;
+    write_desktops();
+    page->active_window = tracked_active_window();
+    find_active();
+    end_write();
+
+    INFO(("Status page: %s", settings.status_file));
+}
+
+/**
+ * Remove the status page
+ * @note at exit: the mapping is left alone until the process ends
+ */
+void
+stop_status()
+{
+    if(page != NULL)
+        unlink(settings.status_file);
+}
+
+/**
+ * Follow the root and client properties the page shows
+ * @note event loop only, after titles_event()
+ */
+void
+status_event(XEvent *event)
+{
+    Atom atom;
+    bool root_event;
+    int i, n, current, nb;
+
+    if(page == NULL || event->type != PropertyNotify)
+        return;
+
+    atom = event->xproperty.atom;
+    root_event = (event->xproperty.window == XDefaultRootWindow(event_display));
+
+    if(root_event && (atom == current_desktop_atom || atom == nb_desktops_atom)) {
+        read_desktops(&current, &nb);
+        begin_write();
+        page->current_desktop = current;
+        page->nb_desktops = nb;
+        write_desktops();
+        end_write();
+    } else if(root_event && atom == client_list_atom) {
+        begin_write();
+        write_desktops();
+
+        /* windows gone, the worker only learns it at its next action */
+        for(i = n = 0; i < page->nb_windows; i++) {
+            if(get_title(page->windows[i].window) != NULL)
+                page->windows[n++] = page->windows[i];
+        }
+        page->nb_windows = n;
+        find_active();
+        end_write();
+    } else if(!root_event && atom == desktop_atom) {
+        begin_write();
+        write_desktops();
+        end_write();
+    }
+}
+
+/**
+ * Window just activated
+ * @note event loop only
+ */
+void
+status_active(Window window)
+{
+    if(page == NULL)
+        return;
+
+    begin_write();
+    page->active_window = window;
+    find_active();
+    end_write();
+}
+
+/**
+ * Publish the zones of the windows tiler placed and the counters of an
+ * action, once done
+ * @param latency   ns from the key press to the end of the action
+ * @note worker only
+ */
+void
+status_action(Move_t move, const XCounters_t *counters, unsigned long long latency)
+{
+    const Client_t *client;
+    StatusWindow_t *w;
+    int i;
+
+    if(page == NULL)
+        return;
+
+    begin_write();
+
+    page->actions++;
+    if(move < STATUS_MOVES)
+        page->action_counts[move]++;
+    page->last_action = move;
+    page->last_latency = latency;
+    page->roundtrips += counters->roundtrips;
+    page->requests += counters->roundtrips + counters->oneway;
+
+    page->nb_windows = 0;
+    for(i = 0; i < CLIENTS_LEN && page->nb_windows < STATUS_WINDOWS; i++) {
+        client = get_client_slot(i);
+        if(client->window == None || (client->zone == MOVESLEN && client->geometry.width == 0))
+            continue;
+
+        w = &page->windows[page->nb_windows++];
+        w->window = client->window;
+        w->monitor = client->monitor;
+        w->zone = (client->zone == MOVESLEN) ? -1 : (int32_t) client->zone;
+        w->desktop = client->known ? client->desktop : -1;
+    }
+    find_active();
+
+    end_write();
+}
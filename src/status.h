@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdint.h>
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+#include "trace.h"
+
+/**
+  @page Status
+
+  Status bars and scripts showing where windows are tiled read it from a
+  status page rather than asking X: a StatusPage_t mapped from
+  <code>$XDG_RUNTIME_DIR/tiler.status</code>, kept up to date by tiler.
+
+  The page holds the active window with its zone and monitor, the
+  monitors, the current desktop and the number of windows of each desktop,
+  the zone of the windows tiler placed, and action counters. The event
+  loop writes what it learns from root and client PropertyNotify events
+  (see @ref Titles), the worker writes the zones and counters after each
+  action.
+
+  Writes are protected by a sequence lock: <code>seq</code> is odd while
+  the page is being written. Readers map the file once, then copy the
+  page until they get the same even <code>seq</code> before and after the
+  copy, without any system call:
+
+  <pre>
+  do {
+      seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+      memcpy(&copy, page, sizeof(StatusPage_t));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != __atomic_load_n(&page->seq, __ATOMIC_RELAXED));
+  </pre>
+
+  Fields have fixed sizes and the page no padding, for readers written in
+  any language. The file is removed when tiler exits.
+  */
+
+#define STATUS_MAGIC        0x72656c74  /* "tler" */
+#define STATUS_VERSION      1
+
+#define STATUS_MONITORS     16
+#define STATUS_DESKTOPS     32
+#define STATUS_WINDOWS      128
+#define STATUS_MOVES        64
+#define STATUS_NAME_LEN     16
+
+/** rectangle of the status page
+ * @struct StatusRect_t
+ */
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} StatusRect_t;
+
+/** window placed by tiler
+ * @struct StatusWindow_t
+ */
+typedef struct {
+    uint64_t window;
+    int32_t monitor;
+    int32_t zone;           /**< index in names, -1 if none */
+    int32_t desktop;        /**< -1 if unknown */
+    int32_t reserved;
+} StatusWindow_t;
+
+/** status page
+ * @struct StatusPage_t
+ */
+typedef struct {
+    uint32_t magic;         /**< STATUS_MAGIC */
+    uint32_t version;       /**< STATUS_VERSION */
+    uint32_t seq;           /**< odd while the page is being written */
+    uint32_t size;          /**< sizeof(StatusPage_t) */
+    uint64_t updated;       /**< time of the last write, ns (CLOCK_MONOTONIC) */
+    uint64_t active_window; /**< 0 if none */
+    uint64_t actions;       /**< actions executed */
+    uint64_t last_latency;  /**< ns from the key press to the end of the last action */
+    uint64_t roundtrips;    /**< X round trips of all actions */
+    uint64_t requests;      /**< X requests of all actions */
+    uint64_t action_counts[STATUS_MOVES];   /**< actions executed, by binding */
+
+    int32_t pid;
+    int32_t active_monitor; /**< -1 if the active window was not placed by tiler */
+    int32_t active_zone;    /**< index in names, -1 if none */
+    int32_t current_desktop;
+    int32_t nb_desktops;    /**< entries of desktop_windows used */
+    int32_t nb_monitors;
+    int32_t nb_windows;     /**< entries of windows used */
+    int32_t last_action;    /**< index in names, -1 if none yet */
+    int32_t desktop_windows[STATUS_DESKTOPS];   /**< client windows on each desktop */
+    StatusRect_t monitors[STATUS_MONITORS];
+    StatusRect_t workareas[STATUS_MONITORS];
+    char names[STATUS_MOVES][STATUS_NAME_LEN];  /**< names of the bindings (zones and actions) */
+    StatusWindow_t windows[STATUS_WINDOWS];
+} StatusPage_t;
+
+void init_status();
+void stop_status();
+void status_event(XEvent *);
+void status_active(Window);
+void status_action(Move_t, const XCounters_t *, unsigned long long);
+
+#endif /* STATUS_H */
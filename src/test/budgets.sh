@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Replay the callbacks with a budget on 1, 10 and 1000 windows, against the
+# scripted display (test/fakex.c): fails if an action goes over the round
+# trips or requests budget of its binding.
+#
+# usage: budgets.sh <tiler linked with fakex.o> <configuration file>
+#
+
+tiler=${1:-./tiler-check}
+conf=${2:-tiler.conf.dist}
+capture=${TMPDIR:-/tmp}/tiler-budgets.$$.capture
+output=${TMPDIR:-/tmp}/tiler-budgets.$$.out
+
+trap 'rm -f "$capture" "$output"' EXIT
+
+# two monitors, a dock, n windows spread on both, then every binding
+write_capture() {
+    awk -v n="$1" 'BEGIN {
+        print "# budgets: " n " windows"
+        print "monitor 0 0 1920 1080"
+        print "monitor 1920 0 1920 1080"
+        print "window 0xd 0 0 1920 30 0 2 0 panel Panel panel"
+        for(i = 1; i <= n; i++)
+            printf("window 0x%x %d %d 640 480 0 128 0 xterm XTerm window %d\n",
+                   i, (i % 2) * 1920 + (i * 7) % 800, 40 + (i * 5) % 500, i)
+
+        printf("clients 0 0xd")
+        for(i = 1; i <= n; i++)
+            printf(" 0x%x", i)
+        printf("\n")
+        printf("active 0 0x%x\n", n)
+        print "desktop 0 0"
+
+        split("top topleft topright bottom bottomleft bottomright left right top top " \
+              "leftscreen rightscreen grid sidebyside maximize listwindows", keys, " ")
+        for(k = 1; k in keys; k++)
+            print "key " k * 100 " " keys[k]
+    }'
+}
+
+for n in 1 10 1000; do
+    write_capture $n > "$capture"
+    if ! "$tiler" -c "$conf" --replay "$capture" > "$output" 2>&1; then
+        grep -v "^[+* ]* Window " "$output"
+        echo "budgets: FAILED with $n windows"
+        exit 1
+    fi
+    grep "over budget\|Replayed" "$output"
+    echo "budgets: $n windows ok"
+done
@@ -0,0 +1,1123 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+  @page FakeX
+
+  Scripted display for <code>make check</code>: the Xlib calls tiler makes,
+  served from memory instead of an X server. Linked in place of libX11,
+  it lets the replay and the soak test run anywhere, with the same requests
+  (and so the same counters) as on a real server.
+
+  It keeps windows (geometry, mapping, properties), interned atoms and one
+  event queue per connection. PropertyNotify, ConfigureNotify and
+  Map/UnmapNotify are queued to the connections which selected them, and
+  client messages sent to the root window are handled the way a window
+  manager would (active window, desktop, states, move-resize).
+
+  Keyboard, Xinerama, XSync and XInput 2 report no extension and no key:
+  tiler runs without them.
+
+  @note every call takes a single lock, both connections (event loop and
+  worker) may be used at once
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/sync.h>
+#ifdef HAVE_XINPUT2
+#include <X11/extensions/XInput2.h>
+#endif
+
+#define FAKE_DISPLAYS   4
+#define FAKE_QUEUE_LEN  16384
+#define FAKE_WIDTH      3840
+#define FAKE_HEIGHT     1080
+#define FAKE_ROOT       0x100
+#define FAKE_FIRST_ID   0x200000
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* events queued for a connection */
+typedef struct {
+    XEvent events[FAKE_QUEUE_LEN];
+    int head, count;
+} FakeQueue_t;
+
+typedef struct {
+    Atom name;
+    Atom type;
+    int format;
+    unsigned long nitems;
+    unsigned char *data;        /* as given to XChangeProperty: longs for format 32 */
+} FakeProperty_t;
+
+typedef struct {
+    Window id;
+    int x, y, width, height;
+    bool mapped;
+    long masks[FAKE_DISPLAYS];
+    FakeProperty_t *properties;
+    int nb_properties;
+} FakeWindow_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _XPrivDisplay displays[FAKE_DISPLAYS];
+static FakeQueue_t *queues[FAKE_DISPLAYS];
+static Screen screen;
+
+static FakeWindow_t *windows = NULL;   /* root first, then FAKE_FIRST_ID onwards */
+static int nb_windows = 0;
+
+static char **atoms = NULL;             /* names of atoms past XA_LAST_PREDEFINED */
+static int nb_atoms = 0;
+
+/* predefined atoms tiler looks up by name */
+static const struct {
+    const char *name;
+    Atom atom;
+} predefined[] = {
+    {"ATOM", XA_ATOM}, {"CARDINAL", XA_CARDINAL}, {"STRING", XA_STRING},
+    {"WINDOW", XA_WINDOW}, {"WM_NAME", XA_WM_NAME}, {"WM_CLASS", XA_WM_CLASS},
+    {"WM_NORMAL_HINTS", XA_WM_NORMAL_HINTS},
+};
+
+static void *
+xalloc(size_t size)
+{
+    void *ptr = calloc(1, size);
+
+    if(ptr == NULL) {
+        fprintf(stderr, "fakex: out of memory\n");
+        abort();
+    }
+    return ptr;
+}
+
+static int
+display_index(Display *dpy)
+{
+    int i;
+
+    for(i = 0; i < FAKE_DISPLAYS; i++) {
+        if(displays[i] == (_XPrivDisplay) dpy)
+            return i;
+    }
+    return -1;
+}
+
+static FakeWindow_t *
+find_window(Window id)
+{
+    int i;
+
+    if(id == FAKE_ROOT)
+        i = 0;
+    else if(id >= FAKE_FIRST_ID)
+        i = id - FAKE_FIRST_ID + 1;
+    else
+        return NULL;
+
+    return (i < nb_windows) ? &windows[i] : NULL;
+}
+
+static Atom
+intern(const char *name)
+{
+    int i;
+
+    for(i = 0; i < sizeof(predefined) / sizeof(predefined[0]); i++) {
+        if(strcmp(predefined[i].name, name) == 0)
+            return predefined[i].atom;
+    }
+    for(i = 0; i < nb_atoms; i++) {
+        if(strcmp(atoms[i], name) == 0)
+            return XA_LAST_PREDEFINED + 1 + i;
+    }
+
+    atoms = realloc(atoms, (nb_atoms + 1) * sizeof(char *));
+    atoms[nb_atoms] = strdup(name);
+    if(atoms[nb_atoms] == NULL) {
+        fprintf(stderr, "fakex: out of memory\n");
+        abort();
+    }
+    return XA_LAST_PREDEFINED + 1 + nb_atoms++;
+}
+
+/** Queue an event for every connection selecting mask on window */
+static void
+deliver(FakeWindow_t *w, long mask, XEvent *event)
+{
+    FakeQueue_t *q;
+    int i;
+
+    for(i = 0; i < FAKE_DISPLAYS; i++) {
+        if(displays[i] == NULL || !(w->masks[i] & mask))
+            continue;
+
+        q = queues[i];
+        if(q->count == FAKE_QUEUE_LEN)
+            continue;
+        q->events[(q->head + q->count) % FAKE_QUEUE_LEN] = *event;
+        q->events[(q->head + q->count) % FAKE_QUEUE_LEN].xany.display = (Display *) displays[i];
+        q->count++;
+    }
+}
+
+/** Structure events go to the window, and to the root for its children */
+static void
+deliver_structure(FakeWindow_t *w, XEvent *event)
+{
+    deliver(w, StructureNotifyMask, event);
+    if(w != &windows[0])
+        deliver(&windows[0], SubstructureNotifyMask, event);
+}
+
+static FakeProperty_t *
+find_property(FakeWindow_t *w, Atom name)
+{
+    int i;
+
+    for(i = 0; i < w->nb_properties; i++) {
+        if(w->properties[i].name == name)
+            return &w->properties[i];
+    }
+    return NULL;
+}
+
+static size_t
+item_size(int format)
+{
+    return (format == 32) ? sizeof(long) : (format == 16) ? sizeof(short) : 1;
+}
+
+static void
+change_property(FakeWindow_t *w, Atom name, Atom type, int format, int mode,
+                const unsigned char *data, int nelements)
+{
+    FakeProperty_t *p = find_property(w, name);
+    size_t size = item_size(format);
+    unsigned char *merged;
+    XEvent event;
+
+    if(p == NULL) {
+        w->properties = realloc(w->properties, (w->nb_properties + 1) * sizeof(FakeProperty_t));
+        p = &w->properties[w->nb_properties++];
+        memset(p, 0, sizeof(FakeProperty_t));
+        p->name = name;
+        mode = PropModeReplace;
+    }
+    if(p->format != format || p->type != type)
+        mode = PropModeReplace;
+
+    if(mode == PropModeReplace) {
+        free(p->data);
+        p->data = xalloc(nelements * size + 1);
+        memcpy(p->data, data, nelements * size);
+        p->nitems = nelements;
+    } else {
+        merged = xalloc((p->nitems + nelements) * size + 1);
+        if(mode == PropModeAppend) {
+            memcpy(merged, p->data, p->nitems * size);
+            memcpy(merged + p->nitems * size, data, nelements * size);
+        } else {
+            memcpy(merged, data, nelements * size);
+            memcpy(merged + nelements * size, p->data, p->nitems * size);
+        }
+        free(p->data);
+        p->data = merged;
+        p->nitems += nelements;
+    }
+    p->type = type;
+    p->format = format;
+
+    memset(&event, 0, sizeof(event));
+    event.xproperty.type = PropertyNotify;
+    event.xproperty.window = w->id;
+    event.xproperty.atom = name;
+    event.xproperty.state = PropertyNewValue;
+    deliver(w, PropertyChangeMask, &event);
+}
+
+static void
+configure(FakeWindow_t *w, int x, int y, int width, int height)
+{
+    XEvent event;
+
+    w->x = x;
+    w->y = y;
+    w->width = (width > 0) ? width : 1;
+    w->height = (height > 0) ? height : 1;
+
+    memset(&event, 0, sizeof(event));
+    event.xconfigure.type = ConfigureNotify;
+    event.xconfigure.event = w->id;
+    event.xconfigure.window = w->id;
+    event.xconfigure.x = w->x;
+    event.xconfigure.y = w->y;
+    event.xconfigure.width = w->width;
+    event.xconfigure.height = w->height;
+    deliver_structure(w, &event);
+}
+
+/** Add or remove atoms of _NET_WM_STATE, as asked by a client message */
+static void
+change_states(FakeWindow_t *w, long action, const long *changed)
+{
+    Atom name = intern("_NET_WM_STATE");
+    FakeProperty_t *p = find_property(w, name);
+    long states[16];
+    int i, j, n = 0;
+    bool set;
+
+    if(p != NULL && p->format == 32) {
+        for(i = 0; i < p->nitems && n < 16; i++)
+            states[n++] = ((long *) p->data)[i];
+    }
+
+    for(j = 0; j < 2; j++) {
+        if(changed[j] == 0)
+            continue;
+        for(i = 0, set = false; i < n; i++)
+            set |= (states[i] == changed[j]);
+
+        if(!set && (action == 1 || action == 2) && n < 16) {
+            states[n++] = changed[j];
+        } else if(set && (action == 0 || action == 2)) {
+            for(i = 0; i < n; i++) {
+                if(states[i] == changed[j])
+                    states[i--] = states[--n];
+            }
+        }
+    }
+
+    change_property(w, name, XA_ATOM, 32, PropModeReplace, (unsigned char *) states, n);
+}
+
+/** What the window manager does with a client message sent to the root */
+static void
+handle_message(XClientMessageEvent *message)
+{
+    FakeWindow_t *w = find_window(message->window);
+    const long *l = message->data.l;
+    long value;
+
+    if(w == NULL || message->message_type < XA_LAST_PREDEFINED + 1)
+        return;
+
+    if(message->message_type == intern("_NET_ACTIVE_WINDOW")) {
+        value = message->window;
+        change_property(&windows[0], message->message_type, XA_WINDOW, 32, PropModeReplace,
+                        (unsigned char *) &value, 1);
+    } else if(message->message_type == intern("_NET_WM_DESKTOP")) {
+        value = l[0];
+        change_property(w, message->message_type, XA_CARDINAL, 32, PropModeReplace,
+                        (unsigned char *) &value, 1);
+    } else if(message->message_type == intern("_NET_WM_STATE")) {
+        change_states(w, l[0], l + 1);
+    } else if(message->message_type == intern("_NET_MOVERESIZE_WINDOW")) {
+        configure(w, l[1], l[2], l[3], l[4]);
+    }
+}
+
+/*
+ * Connection
+ */
+
+Status
+XInitThreads()
+{
+    return 1;
+}
+
+XErrorHandler
+XSetErrorHandler(XErrorHandler handler)
+{
+    return NULL;
+}
+
+int
+XGetErrorText(Display *dpy, int code, char *buffer, int length)
+{
+    snprintf(buffer, length, "error %d", code);
+    return 0;
+}
+
+Display *
+XOpenDisplay(const char *name)
+{
+    _XPrivDisplay dpy = NULL;
+    int i;
+
+    pthread_mutex_lock(&lock);
+
+    if(nb_windows == 0) {
+        windows = xalloc(sizeof(FakeWindow_t));
+        windows[0].id = FAKE_ROOT;
+        windows[0].width = FAKE_WIDTH;
+        windows[0].height = FAKE_HEIGHT;
+        windows[0].mapped = true;
+        nb_windows = 1;
+
+        screen.root = FAKE_ROOT;
+        screen.width = FAKE_WIDTH;
+        screen.height = FAKE_HEIGHT;
+        screen.root_depth = 24;
+    }
+
+    for(i = 0; i < FAKE_DISPLAYS; i++) {
+        if(displays[i] != NULL)
+            continue;
+        dpy = displays[i] = xalloc(sizeof(*dpy));
+        queues[i] = xalloc(sizeof(FakeQueue_t));
+        dpy->fd = -1;
+        dpy->nscreens = 1;
+        dpy->default_screen = 0;
+        dpy->screens = &screen;
+        break;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return (Display *) dpy;
+}
+
+int
+XCloseDisplay(Display *dpy)
+{
+    int i, j, d;
+
+    pthread_mutex_lock(&lock);
+
+    if((d = display_index(dpy)) >= 0) {
+        free(queues[d]);
+        free(displays[d]);
+        queues[d] = NULL;
+        displays[d] = NULL;
+        for(i = 0; i < nb_windows; i++)
+            windows[i].masks[d] = 0;
+    }
+
+    /* last one gone: the server goes with it */
+    for(d = 0; d < FAKE_DISPLAYS && displays[d] == NULL; d++);
+    if(d == FAKE_DISPLAYS) {
+        for(i = 0; i < nb_windows; i++) {
+            for(j = 0; j < windows[i].nb_properties; j++)
+                free(windows[i].properties[j].data);
+            free(windows[i].properties);
+        }
+        free(windows);
+        windows = NULL;
+        nb_windows = 0;
+
+        for(i = 0; i < nb_atoms; i++)
+            free(atoms[i]);
+        free(atoms);
+        atoms = NULL;
+        nb_atoms = 0;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+Window
+XDefaultRootWindow(Display *dpy)
+{
+    return FAKE_ROOT;
+}
+
+int
+XDefaultScreen(Display *dpy)
+{
+    return 0;
+}
+
+int
+XDisplayWidth(Display *dpy, int screen_number)
+{
+    return FAKE_WIDTH;
+}
+
+int
+XDisplayHeight(Display *dpy, int screen_number)
+{
+    return FAKE_HEIGHT;
+}
+
+int
+XFlush(Display *dpy)
+{
+    return 1;
+}
+
+int
+XSync(Display *dpy, Bool discard)
+{
+    int d;
+
+    pthread_mutex_lock(&lock);
+    if(discard && (d = display_index(dpy)) >= 0)
+        queues[d]->count = 0;
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+int
+XFree(void *data)
+{
+    free(data);
+    return 1;
+}
+
+Bool
+XQueryExtension(Display *dpy, const char *name, int *opcode, int *event, int *error)
+{
+    return False;
+}
+
+/*
+ * Events
+ */
+
+int
+XPending(Display *dpy)
+{
+    int d, count = 0;
+
+    pthread_mutex_lock(&lock);
+    if((d = display_index(dpy)) >= 0)
+        count = queues[d]->count;
+    pthread_mutex_unlock(&lock);
+
+    return count;
+}
+
+/** Never blocks: callers check XPending() first, nothing else would come */
+int
+XNextEvent(Display *dpy, XEvent *event)
+{
+    FakeQueue_t *q;
+    int d;
+
+    memset(event, 0, sizeof(XEvent));
+
+    pthread_mutex_lock(&lock);
+    if((d = display_index(dpy)) >= 0 && queues[d]->count > 0) {
+        q = queues[d];
+        *event = q->events[q->head];
+        q->head = (q->head + 1) % FAKE_QUEUE_LEN;
+        q->count--;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+Bool
+XCheckTypedEvent(Display *dpy, int type, XEvent *event)
+{
+    FakeQueue_t *q;
+    Bool found = False;
+    int d, i;
+
+    pthread_mutex_lock(&lock);
+    if((d = display_index(dpy)) >= 0) {
+        q = queues[d];
+        for(i = 0; i < q->count && !found; i++) {
+            if(q->events[(q->head + i) % FAKE_QUEUE_LEN].type != type)
+                continue;
+            *event = q->events[(q->head + i) % FAKE_QUEUE_LEN];
+            for(; i < q->count - 1; i++)
+                q->events[(q->head + i) % FAKE_QUEUE_LEN] = q->events[(q->head + i + 1) % FAKE_QUEUE_LEN];
+            q->count--;
+            found = True;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return found;
+}
+
+int
+XSelectInput(Display *dpy, Window window, long mask)
+{
+    FakeWindow_t *w;
+    int d;
+
+    pthread_mutex_lock(&lock);
+    if((d = display_index(dpy)) >= 0 && (w = find_window(window)) != NULL)
+        w->masks[d] = mask;
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+Status
+XSendEvent(Display *dpy, Window window, Bool propagate, long mask, XEvent *event)
+{
+    pthread_mutex_lock(&lock);
+    if(window == FAKE_ROOT && event->type == ClientMessage)
+        handle_message(&event->xclient);
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+/*
+ * Atoms and properties
+ */
+
+Atom
+XInternAtom(Display *dpy, const char *name, Bool only_if_exists)
+{
+    Atom atom;
+
+    pthread_mutex_lock(&lock);
+    atom = intern(name);
+    pthread_mutex_unlock(&lock);
+
+    return atom;
+}
+
+int
+XChangeProperty(Display *dpy, Window window, Atom property, Atom type, int format,
+                int mode, const unsigned char *data, int nelements)
+{
+    FakeWindow_t *w;
+
+    pthread_mutex_lock(&lock);
+    if((w = find_window(window)) != NULL)
+        change_property(w, property, type, format, mode, data, nelements);
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+/** Offsets and lengths are in 32-bit units, as on the wire */
+int
+XGetWindowProperty(Display *dpy, Window window, Atom property, long offset, long length,
+                   Bool delete, Atom req_type, Atom *actual_type, int *actual_format,
+                   unsigned long *nitems, unsigned long *bytes_after, unsigned char **data)
+{
+    FakeWindow_t *w;
+    FakeProperty_t *p = NULL;
+    unsigned long first, count, per_unit;
+
+    *actual_type = None;
+    *actual_format = 0;
+    *nitems = *bytes_after = 0;
+    *data = NULL;
+
+    pthread_mutex_lock(&lock);
+
+    if((w = find_window(window)) == NULL) {
+        pthread_mutex_unlock(&lock);
+        return BadWindow;
+    }
+
+    if((p = find_property(w, property)) != NULL) {
+        *actual_type = p->type;
+        *actual_format = p->format;
+    }
+    if(p == NULL || (req_type != AnyPropertyType && req_type != p->type)) {
+        pthread_mutex_unlock(&lock);
+        return Success;
+    }
+
+    /* items per 32-bit unit */
+    per_unit = 32 / p->format;
+    first = MIN((unsigned long) offset * per_unit, p->nitems);
+    count = MIN((unsigned long) length * per_unit, p->nitems - first);
+
+    *data = xalloc(count * item_size(p->format) + 1);
+    memcpy(*data, p->data + first * item_size(p->format), count * item_size(p->format));
+    *nitems = count;
+    *bytes_after = (p->nitems - first - count) * (p->format / 8);
+
+    pthread_mutex_unlock(&lock);
+
+    return Success;
+}
+
+Atom *
+XListProperties(Display *dpy, Window window, int *count)
+{
+    FakeWindow_t *w;
+    Atom *list = NULL;
+    int i;
+
+    *count = 0;
+
+    pthread_mutex_lock(&lock);
+    if((w = find_window(window)) != NULL && w->nb_properties > 0) {
+        list = xalloc(w->nb_properties * sizeof(Atom));
+        for(i = 0; i < w->nb_properties; i++)
+            list[i] = w->properties[i].name;
+        *count = w->nb_properties;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return list;
+}
+
+int
+XStoreName(Display *dpy, Window window, const char *name)
+{
+    return XChangeProperty(dpy, window, XA_WM_NAME, XA_STRING, 8, PropModeReplace,
+                           (const unsigned char *) name, strlen(name));
+}
+
+Status
+XFetchName(Display *dpy, Window window, char **name)
+{
+    Atom type;
+    int format;
+    unsigned long nitems, after;
+    unsigned char *data = NULL;
+
+    XGetWindowProperty(dpy, window, XA_WM_NAME, 0, 1024, False, XA_STRING,
+                       &type, &format, &nitems, &after, &data);
+    *name = (char *) data;
+
+    return data != NULL;
+}
+
+int
+XSetClassHint(Display *dpy, Window window, XClassHint *hint)
+{
+    size_t name = strlen(hint->res_name), class = strlen(hint->res_class);
+    char *buffer = xalloc(name + class + 2);
+    int status;
+
+    memcpy(buffer, hint->res_name, name + 1);
+    memcpy(buffer + name + 1, hint->res_class, class + 1);
+    status = XChangeProperty(dpy, window, XA_WM_CLASS, XA_STRING, 8, PropModeReplace,
+                             (unsigned char *) buffer, name + class + 2);
+    free(buffer);
+
+    return status;
+}
+
+Status
+XGetClassHint(Display *dpy, Window window, XClassHint *hint)
+{
+    Atom type;
+    int format;
+    unsigned long nitems, after;
+    unsigned char *data = NULL;
+    size_t name;
+
+    hint->res_name = hint->res_class = NULL;
+    XGetWindowProperty(dpy, window, XA_WM_CLASS, 0, 1024, False, XA_STRING,
+                       &type, &format, &nitems, &after, &data);
+    if(data == NULL)
+        return 0;
+
+    name = strnlen((char *) data, nitems);
+    hint->res_name = strdup((char *) data);
+    hint->res_class = strdup((name < nitems) ? (char *) data + name + 1 : "");
+    free(data);
+
+    return 1;
+}
+
+/** No client of the scripted display sets size hints */
+Status
+XGetWMNormalHints(Display *dpy, Window window, XSizeHints *hints, long *supplied)
+{
+    memset(hints, 0, sizeof(XSizeHints));
+    *supplied = 0;
+    return 0;
+}
+
+Status
+XGetWMProtocols(Display *dpy, Window window, Atom **protocols, int *count)
+{
+    *protocols = NULL;
+    *count = 0;
+    return 0;
+}
+
+/*
+ * Windows
+ */
+
+Window
+XCreateSimpleWindow(Display *dpy, Window parent, int x, int y, unsigned int width,
+                    unsigned int height, unsigned int border_width,
+                    unsigned long border, unsigned long background)
+{
+    FakeWindow_t *w;
+
+    pthread_mutex_lock(&lock);
+
+    windows = realloc(windows, (nb_windows + 1) * sizeof(FakeWindow_t));
+    w = &windows[nb_windows];
+    memset(w, 0, sizeof(FakeWindow_t));
+    w->id = FAKE_FIRST_ID + nb_windows - 1;
+    w->x = x;
+    w->y = y;
+    w->width = width;
+    w->height = height;
+    nb_windows++;
+
+    pthread_mutex_unlock(&lock);
+
+    return w->id;
+}
+
+static int
+set_mapped(Window window, bool mapped)
+{
+    FakeWindow_t *w;
+    XEvent event;
+
+    pthread_mutex_lock(&lock);
+
+    if((w = find_window(window)) != NULL && w->mapped != mapped) {
+        w->mapped = mapped;
+
+        memset(&event, 0, sizeof(event));
+        event.type = mapped ? MapNotify : UnmapNotify;
+        event.xmap.event = window;
+        event.xmap.window = window;
+        deliver_structure(w, &event);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+int
+XMapWindow(Display *dpy, Window window)
+{
+    return set_mapped(window, true);
+}
+
+int
+XUnmapWindow(Display *dpy, Window window)
+{
+    return set_mapped(window, false);
+}
+
+int
+XMoveWindow(Display *dpy, Window window, int x, int y)
+{
+    FakeWindow_t *w;
+
+    pthread_mutex_lock(&lock);
+    if((w = find_window(window)) != NULL)
+        configure(w, x, y, w->width, w->height);
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+int
+XMoveResizeWindow(Display *dpy, Window window, int x, int y, unsigned int width, unsigned int height)
+{
+    FakeWindow_t *w;
+
+    pthread_mutex_lock(&lock);
+    if((w = find_window(window)) != NULL)
+        configure(w, x, y, width, height);
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+Status
+XGetWindowAttributes(Display *dpy, Window window, XWindowAttributes *attributes)
+{
+    FakeWindow_t *w;
+    int d;
+
+    memset(attributes, 0, sizeof(XWindowAttributes));
+
+    pthread_mutex_lock(&lock);
+
+    if((w = find_window(window)) == NULL) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    attributes->x = w->x;
+    attributes->y = w->y;
+    attributes->width = w->width;
+    attributes->height = w->height;
+    attributes->depth = 24;
+    attributes->root = FAKE_ROOT;
+    attributes->screen = &screen;
+    attributes->map_state = w->mapped ? IsViewable : IsUnmapped;
+    if((d = display_index(dpy)) >= 0)
+        attributes->your_event_mask = w->masks[d];
+
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+/** Windows are all children of the root */
+Bool
+XTranslateCoordinates(Display *dpy, Window src, Window dest, int src_x, int src_y,
+                      int *dest_x, int *dest_y, Window *child)
+{
+    FakeWindow_t *from, *to;
+
+    pthread_mutex_lock(&lock);
+
+    from = find_window(src);
+    to = find_window(dest);
+    *dest_x = src_x + (from ? from->x : 0) - (to ? to->x : 0);
+    *dest_y = src_y + (from ? from->y : 0) - (to ? to->y : 0);
+    *child = None;
+
+    pthread_mutex_unlock(&lock);
+
+    return from != NULL && to != NULL;
+}
+
+/** Client windows are the children of the root, and have no child */
+Status
+XQueryTree(Display *dpy, Window window, Window *root_return, Window *parent,
+           Window **children, unsigned int *count)
+{
+    int i;
+
+    *root_return = FAKE_ROOT;
+    *parent = (window == FAKE_ROOT) ? None : FAKE_ROOT;
+    *children = NULL;
+    *count = 0;
+
+    pthread_mutex_lock(&lock);
+    if(window == FAKE_ROOT && nb_windows > 1) {
+        *children = xalloc((nb_windows - 1) * sizeof(Window));
+        for(i = 1; i < nb_windows; i++)
+            (*children)[i - 1] = windows[i].id;
+        *count = nb_windows - 1;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 1;
+}
+
+Bool
+XQueryPointer(Display *dpy, Window window, Window *root_return, Window *child,
+              int *root_x, int *root_y, int *x, int *y, unsigned int *mask)
+{
+    *root_return = FAKE_ROOT;
+    *child = None;
+    *root_x = *root_y = *x = *y = 0;
+    *mask = 0;
+    return True;
+}
+
+/*
+ * Keyboard: no key, bindings are queued directly
+ */
+
+KeySym
+XStringToKeysym(const char *name)
+{
+    return NoSymbol;
+}
+
+char *
+XKeysymToString(KeySym keysym)
+{
+    return NULL;
+}
+
+KeyCode
+XKeysymToKeycode(Display *dpy, KeySym keysym)
+{
+    return 0;
+}
+
+int
+XDisplayKeycodes(Display *dpy, int *min, int *max)
+{
+    *min = 8;
+    *max = 255;
+    return 1;
+}
+
+XModifierKeymap *
+XGetModifierMapping(Display *dpy)
+{
+    XModifierKeymap *map = xalloc(sizeof(XModifierKeymap));
+
+    map->max_keypermod = 1;
+    map->modifiermap = xalloc(8 * sizeof(KeyCode));
+    return map;
+}
+
+int
+XFreeModifiermap(XModifierKeymap *map)
+{
+    if(map != NULL)
+        free(map->modifiermap);
+    free(map);
+    return 1;
+}
+
+int
+XGrabKey(Display *dpy, int keycode, unsigned int modifiers, Window window,
+         Bool owner_events, int pointer_mode, int keyboard_mode)
+{
+    return 1;
+}
+
+int
+XUngrabKey(Display *dpy, int keycode, unsigned int modifiers, Window window)
+{
+    return 1;
+}
+
+int
+XRefreshKeyboardMapping(XMappingEvent *event)
+{
+    return 1;
+}
+
+KeySym
+XkbKeycodeToKeysym(Display *dpy, KeyCode keycode, int group, int level)
+{
+    return NoSymbol;
+}
+
+Bool
+XkbQueryExtension(Display *dpy, int *opcode, int *event, int *error, int *major, int *minor)
+{
+    return False;
+}
+
+Bool
+XkbSelectEvents(Display *dpy, unsigned int device, unsigned int affect, unsigned int values)
+{
+    return False;
+}
+
+Status
+XkbRefreshKeyboardMapping(XkbMapNotifyEvent *event)
+{
+    return 0;
+}
+
+/*
+ * Extensions: none
+ */
+
+Bool
+XineramaIsActive(Display *dpy)
+{
+    return False;
+}
+
+XineramaScreenInfo *
+XineramaQueryScreens(Display *dpy, int *number)
+{
+    *number = 0;
+    return NULL;
+}
+
+Bool
+XSyncQueryExtension(Display *dpy, int *event_base, int *error_base)
+{
+    return False;
+}
+
+Status
+XSyncInitialize(Display *dpy, int *major, int *minor)
+{
+    return 0;
+}
+
+void
+XSyncIntsToValue(XSyncValue *value, unsigned int low, int high)
+{
+    value->lo = low;
+    value->hi = high;
+}
+
+int
+XSyncValueHigh32(XSyncValue value)
+{
+    return value.hi;
+}
+
+unsigned int
+XSyncValueLow32(XSyncValue value)
+{
+    return value.lo;
+}
+
+Status
+XSyncQueryCounter(Display *dpy, XSyncCounter counter, XSyncValue *value)
+{
+    return 0;
+}
+
+XSyncAlarm
+XSyncCreateAlarm(Display *dpy, unsigned long mask, XSyncAlarmAttributes *attributes)
+{
+    return None;
+}
+
+Status
+XSyncDestroyAlarm(Display *dpy, XSyncAlarm alarm)
+{
+    return 1;
+}
+
+#ifdef HAVE_XINPUT2
+Status
+XIQueryVersion(Display *dpy, int *major, int *minor)
+{
+    return BadRequest;
+}
+
+int
+XISelectEvents(Display *dpy, Window window, XIEventMask *masks, int count)
+{
+    return 0;
+}
+#endif
+
+Bool
+XGetEventData(Display *dpy, XGenericEventCookie *cookie)
+{
+    return False;
+}
+
+void
+XFreeEventData(Display *dpy, XGenericEventCookie *cookie)
+{
+}
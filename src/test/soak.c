@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+  @page Soak
+
+  Soak test for <code>make check</code>: the same actions over and over on
+  the scripted display (see @ref FakeX), with the active window moving and
+  windows leaving and coming back in between. Once warmed up (the arena at
+  its peak size, every client and state known) the heap must not grow:
+  anything left behind by an action shows up after enough of them.
+
+  usage: soak -c tiler.conf
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+
+#include "../tiler.h"
+#include "../utils.h"
+#include "../config.h"
+#include "../keybindings.h"
+#include "../geometries.h"
+#include "../xactions.h"
+#include "../worker.h"
+#include "../arena.h"
+#include "../rules.h"
+#include "../pace.h"
+
+#define SOAK_WINDOWS    24
+#define SOAK_ACTIONS    100000
+#define SOAK_WARMUP     (SOAK_ACTIONS / 10)
+
+/* what tiler.c provides to the other modules */
+Display *display, *event_display;
+Window root;
+
+void
+quit(int status)
+{
+    flush_log();
+    exit(status);
+}
+
+bool
+quitting()
+{
+    return false;
+}
+
+/* actions replayed in turn, all but those writing files or printing */
+static const Move_t moves[] = {
+    TOP, TOPRIGHT, TOPLEFT, BOTTOM, BOTTOMRIGHT, BOTTOMLEFT, RIGHT, LEFT, TOP, TOP,
+    LEFTSCREEN, RIGHTSCREEN, GRID, GROWSPLIT, SHRINKSPLIT, SIDEBYSIDE, MAXIMIZE,
+    RELAYOUT, FOCUSLEFT, FOCUSRIGHT, FOCUSUP, FOCUSDOWN,
+    SWAPLEFT, SWAPRIGHT, SWAPUP, SWAPDOWN,
+};
+
+static Window windows[SOAK_WINDOWS];
+
+static void
+set_root_property(const char *property, Atom type, long *values, int n)
+{
+    XChangeProperty(event_display, root, get_atom(event_display, property),
+                    type, 32, PropModeReplace, (unsigned char *) values, n);
+}
+
+/** Let the event loop see what changed, as replay does */
+static void
+dispatch_events()
+{
+    XEvent event;
+
+    while(XPending(event_display)) {
+        XNextEvent(event_display, &event);
+        dispatch(&event);
+    }
+}
+
+/** Stacking list without the window left out (-1 for none) */
+static void
+set_clients(int left_out)
+{
+    long list[SOAK_WINDOWS];
+    int i, n = 0;
+
+    for(i = 0; i < SOAK_WINDOWS; i++) {
+        if(i == left_out) {
+            XUnmapWindow(event_display, windows[i]);
+            continue;
+        }
+        XMapWindow(event_display, windows[i]);
+        list[n++] = windows[i];
+    }
+
+    set_root_property("_NET_CLIENT_LIST_STACKING", XA_WINDOW, list, n);
+    set_root_property("_NET_CLIENT_LIST", XA_WINDOW, list, n);
+}
+
+static void
+setup()
+{
+    char instance[] = "xterm", class[] = "XTerm", title[32];
+    XClassHint hint = {instance, class};
+    long value = 0;
+    int i;
+
+    settings.nb_monitors = 2;
+    settings.monitors = (Monitor_t *) calloc(settings.nb_monitors, sizeof(Monitor_t));
+    for(i = 0; i < settings.nb_monitors; i++) {
+        settings.monitors[i].id = i;
+        settings.monitors[i].infos = (Geometry_t) {i * 1920, 0, 1920, 1080};
+        compute_usable_area(i, NULL, 0, &settings.monitors[i].workarea);
+    }
+    settings.corrections_file[0] = '\0';
+
+    display = XOpenDisplay(NULL);
+    event_display = XOpenDisplay(NULL);
+    root = XDefaultRootWindow(display);
+
+    for(i = 0; i < SOAK_WINDOWS; i++) {
+        windows[i] = XCreateSimpleWindow(event_display, root, (i % 2) * 1920 + i * 20,
+                                         40 + i * 10, 640, 480, 0, 0, 0);
+        snprintf(title, sizeof(title), "window %d", i);
+        XSetClassHint(event_display, windows[i], &hint);
+        XStoreName(event_display, windows[i], title);
+        XChangeProperty(event_display, windows[i], get_atom(event_display, "_NET_WM_DESKTOP"),
+                        XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &value, 1);
+        set_window_types(event_display, windows[i], 1 << WINDOW_NORMAL);
+    }
+    set_clients(-1);
+    set_root_property("_NET_CURRENT_DESKTOP", XA_CARDINAL, &value, 1);
+    value = windows[0];
+    set_root_property("_NET_ACTIVE_WINDOW", XA_WINDOW, &value, 1);
+
+    check_wm_support();
+    setup_bindings_data();
+    parse_conf_file(settings.filename);
+    track_active_window();
+    init_pace();
+    start_worker();
+}
+
+int
+main(int argc, char **argv)
+{
+    const int nb_moves = sizeof(moves) / sizeof(moves[0]);
+    size_t warm = 0, heap;
+    long active;
+    int i;
+
+    parse_opt(argc, argv);
+    start_logger();
+    setup();
+
+    for(i = 0; i < SOAK_ACTIONS; i++) {
+        if(i == SOAK_WARMUP)
+            warm = get_heap_in_use();
+
+        /* another window gets the focus, another one leaves for a while */
+        if(i % 7 == 0) {
+            active = windows[(i / 7) % SOAK_WINDOWS];
+            set_root_property("_NET_ACTIVE_WINDOW", XA_WINDOW, &active, 1);
+        }
+        if(i % 13 == 0)
+            set_clients((i / 13) % (SOAK_WINDOWS + 1) - 1);
+        dispatch_events();
+
+        queue_binding(moves[i % nb_moves]);
+        wait_worker();
+    }
+    dispatch_events();
+    heap = get_heap_in_use();
+
+    stop_worker();
+    clear_bindings();
+    free_config();
+    free_rules();
+    XCloseDisplay(event_display);
+    XCloseDisplay(display);
+    flush_log();
+
+    if(warm == 0) {
+        printf("soak: heap in use unknown, skipped\n");
+        return EXIT_SUCCESS;
+    }
+
+    printf("soak: %d actions, heap %zu bytes after %d, %zu bytes at the end\n",
+           SOAK_ACTIONS, warm, SOAK_WARMUP, heap);
+    if(heap > warm) {
+        printf("soak: FAILED, the heap grew by %zu bytes\n", heap - warm);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
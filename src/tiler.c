@@ -22,6 +22,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <X11/Xlib.h>
 
@@ -30,16 +31,49 @@
 #include "keybindings.h"
 #include "geometries.h"
 #include "xactions.h"
+#include "worker.h"
+#include "trace.h"
+#include "arena.h"
+#include "snap.h"
+#include "autotile.h"
+#include "layout.h"
+#include "rules.h"
+#include "plan.h"
+#include "flight.h"
+#include "replay.h"
+#include "pace.h"
+#include "corrections.h"
+#include "titles.h"
+#include "ipc.h"
+#include "status.h"
 
 /* extern display & root */
 Display *display = NULL;
+Display *event_display = NULL;
 Window root = BadWindow;
 
-void
+/* set from signal handler, processed by the event loop */
+static volatile sig_atomic_t dump_requested = 0;
+static volatile sig_atomic_t flight_requested = 0;
+static volatile sig_atomic_t exit_requested = 0;
+static int exit_status = EXIT_SUCCESS;
+
+/* written to on exit requests, so that the event loop leaves poll() */
+static int exit_pipe[2] = {-1, -1};
+
+/**
+ * Release everything, once the worker is stopped
+ */
+static void
 cleanup()
 {
     clear_bindings();
 
+    trace_dump(settings.trace_file);
+    stop_record();
+    stop_ipc();
+    stop_status();
+
     /* remove pid file */
     unlink(settings.pidfile);
 
@@ -47,17 +81,107 @@ cleanup()
     //XCloseDisplay(display);
 
     free_config();
+    unload_layout();
+    save_corrections();
+    free_rules();
+
+    /* last, the worker being joined: nothing can log anymore */
+    flush_log();
+}
+
+/** Ask the event loop to leave, async-signal-safe */
+static void
+request_exit()
+{
+    exit_requested = 1;
+    if(exit_pipe[1] >= 0 && write(exit_pipe[1], "", 1) < 0)
+        return;     /* full: the event loop is woken up already */
+}
+
+/**
+ * Leave tiler, from any thread
+ *
+ * Nothing is freed while the worker may still use it: on the worker, only
+ * ask the event loop to leave and end the thread, the event loop stopping
+ * the worker before cleaning up. On failure, the flight recorder is dumped
+ * first (see @ref Flight).
+ * @note never returns
+ */
+void
+quit(int status)
+{
+    if(status != EXIT_SUCCESS)
+        flight_dump(NULL);
+
+    if(on_worker()) {
+        exit_status = status;
+        request_exit();
+        abort_worker();
+    }
+
+    stop_worker();
+    cleanup();
+    exit(status);
+}
+
+/**
+ * Whether tiler is leaving, for loops outside of the event loop (replay)
+ */
+bool
+quitting()
+{
+    return exit_requested;
 }
 
 void
 signal_handler(int sig)
 {
-    if(sig == SIGTERM || sig == SIGINT) {
-        D(("Exiting"));
+    /* nothing logged here: the logger's lock may be held by the interrupted thread */
+    if(sig == SIGTERM || sig == SIGINT)
+        request_exit();
+
+    if(sig == SIGUSR1)
+        dump_requested = 1;
+
+    if(sig == SIGUSR2)
+        flight_requested = 1;
+}
 
-        /* @todo should interrupt listening loop with a XSendEvent */
-        cleanup();
-        exit(0);
+/**
+ * Windows may disappear at any time between two requests about them
+ * (more so with auto-tiling reacting to windows being destroyed): log the
+ * error rather than letting Xlib exit.
+ */
+static int
+error_handler(Display *dpy, XErrorEvent *error)
+{
+    char text[128];
+
+    XGetErrorText(dpy, error->error_code, text, sizeof(text));
+    WARN(("X error on request %d, resource 0x%lx: %s", error->request_code, error->resourceid, text));
+
+    return 0;
+}
+
+/**
+ * Handle requests made by signals, outside of the handler
+ */
+static void
+handle_requests()
+{
+    if(dump_requested) {
+        dump_requested = 0;
+        print_stats();
+        print_arena_stats();
+        print_snap_stats();
+        print_autotile_stats();
+        print_pace_stats();
+        trace_dump(settings.trace_file);
+    }
+
+    if(flight_requested) {
+        flight_requested = 0;
+        flight_dump(settings.flight_file);
     }
 }
 
@@ -77,9 +201,38 @@ main(int argc, char **argv)
 
     parse_opt(argc, argv);
 
+    /* from now on, never block on stdout */
+    start_logger();
+
+    /* offline, nothing below applies */
+    if(settings.plan_file[0] != '\0') {
+        int status = run_plan(settings.plan_file);
+        flush_log();
+        return status;
+    }
+
+    /* runs on a server of its own, without pid file nor key grabs */
+    if(settings.replay_file[0] != '\0') {
+        int status;
+
+        XInitThreads();
+        XSetErrorHandler(error_handler);
+        status = run_replay(settings.replay_file);
+        flush_log();
+        return exit_requested ? exit_status : status;
+    }
+
+    /* the write end is non blocking, as signal handlers write to it */
+    if(pipe(exit_pipe) < 0 || fcntl(exit_pipe[1], F_SETFL, O_NONBLOCK) < 0) {
+        WARN(("Cannot create exit pipe: %s", strerror(errno)));
+        return EXIT_FAILURE;
+    }
+
     /* signal capture */
     signal(SIGTERM, signal_handler);
     signal(SIGINT, signal_handler);
+    signal(SIGUSR1, signal_handler);
+    signal(SIGUSR2, signal_handler);
 
     /*
      * daemonize
@@ -106,7 +259,7 @@ main(int argc, char **argv)
     int pidfile = open(settings.pidfile, O_CREAT | O_EXCL | O_WRONLY);
     if(pidfile == -1) {
         if(errno == EEXIST)
-            D(("pid file \"%s\" already exists", settings.pidfile));
+            WARN(("pid file \"%s\" already exists", settings.pidfile));
 
         if(!settings.force_run)
             exit(1);
@@ -117,16 +270,25 @@ main(int argc, char **argv)
         close(pidfile);
     }
 
+    /*
+     * two connections: "display" is used for the actual work and will be
+     * handed to the worker thread, "event_display" only listens to keys
+     */
+    XInitThreads();
+    XSetErrorHandler(error_handler);
+
     /** @todo isolate display and root variables in xactions.c */
     display = XOpenDisplay(NULL);
-    if(display == NULL) {
-        D(("Cannot connect to X server"));
+    event_display = XOpenDisplay(NULL);
+    if(display == NULL || event_display == NULL) {
+        WARN(("Cannot connect to X server"));
         return EXIT_FAILURE;
     }
 
     root = XDefaultRootWindow(display);
 
     check_compiz_wm();
+    check_wm_support();
 
     /* get monitors info */
     get_monitors_config(display, root);
@@ -138,22 +300,82 @@ main(int argc, char **argv)
      * keybinding setup
      */
     parse_conf_file(settings.filename);
+    init_keymap();
 
     if(settings.verbose) {
         print_config();
         print_geometries();
     }
 
+    load_layout();
+    load_corrections();
+
+    /* startup lists, the arena goes to the worker as well */
+    arena_reset();
+
+    /* display now belongs to the worker */
+    track_active_window();
+    if(settings.record_file[0] != '\0')
+        start_record(settings.record_file);
+    init_autotile();
+    init_snap();
+    init_pace();
+    init_titles();
+    init_status();
+    start_ipc();
+    start_worker();
+
     /**
      * main key event listening loop
      */
-    for(;;) {
-        XNextEvent(display, &event);
+    while(!exit_requested) {
+        struct pollfd fds[2 + IPC_POLLFDS] = {
+            {ConnectionNumber(event_display), POLLIN, 0},
+            {exit_pipe[0], POLLIN, 0}
+        };
+        int nfds = 2 + ipc_pollfds(fds + 2);
+
+        /* wait in poll() rather than XNextEvent() so signals get through,
+         * wake up as well when a relayout is due, or a socket client talks;
+         * with X events pending, only look at the socket without waiting */
+        if(poll(fds, nfds, XPending(event_display) ? 0 : autotile_timeout()) < 0 && errno != EINTR)
+            FATAL(("poll failed: %s", strerror(errno)));
+
+        if(exit_requested)
+            break;
+
+        /* every iteration: a stream of X events (raw motion during a drag)
+         * must starve neither socket clients nor dump requests */
+        ipc_handle(fds + 2, nfds - 2);
+        handle_requests();
+
+        if(!XPending(event_display)) {
+            autotile_flush();
+            continue;
+        }
+
+        XNextEvent(event_display, &event);
+
+        /* coalesce bursts: drain every pending event before the worker acts */
+        hold_worker();
         dispatch(&event);
+        while(XPending(event_display)) {
+            XNextEvent(event_display, &event);
+            dispatch(&event);
+        }
+        keymap_flush();
+        snap_flush();
+        autotile_flush();
+        release_worker();
     }
 
+    D(("Exiting"));
+
+    /* the worker may be in the middle of an action: wait for it first */
+    stop_worker();
     cleanup();
+    XCloseDisplay(event_display);
     XCloseDisplay(display);
 
-    return EXIT_SUCCESS;
+    return exit_status;
 }
@@ -17,6 +17,7 @@
 #ifndef TILER_H
 #define TILER_H
 
+#include <stdbool.h>
 #include <X11/Xlib.h>
 #define TILER_VERSION_STR   "0.2b"
 
@@ -30,6 +31,17 @@ typedef struct {
     int height;
 } Geometry_t;
 
+/**
+ * Sizes a window accepts (<code>WM_NORMAL_HINTS</code>): base + k * inc,
+ * at least min. Index 0 is the width, 1 the height; an increment of 0 or 1
+ * means any size.
+ */
+typedef struct {
+    int base[2];
+    int inc[2];
+    int min[2];
+} SizeHints_t;
+
 /**
  * @todo move to bindings.h
  */
@@ -50,6 +62,19 @@ typedef enum {
     SIDEBYSIDE,
     MAXIMIZE,
     LISTWINDOWS,
+    RELAYOUT,
+    SAVELAYOUT,
+    RESTORELAYOUT,
+    GROWSPLIT,
+    SHRINKSPLIT,
+    FOCUSLEFT,
+    FOCUSRIGHT,
+    FOCUSUP,
+    FOCUSDOWN,
+    SWAPLEFT,
+    SWAPRIGHT,
+    SWAPUP,
+    SWAPDOWN,
 
     MOVESLEN
 } Move_t;
@@ -58,7 +83,9 @@ typedef enum {
  * 
  */
 extern Display *display;
+extern Display *event_display;
 extern Window root;
-void cleanup();
+void quit(int);
+bool quitting();
 
 #endif /* TILER_H */
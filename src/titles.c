@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "xactions.h"
+#include "keybindings.h"
+#include "trace.h"
+#include "titles.h"
+
+/** windows listed under a trigram */
+typedef struct {
+    unsigned int key;       /**< the three bytes, 0 for a free bucket */
+    int *slots;
+    int size;
+    int capacity;
+} Trigram_t;
+
+/** slot of a window, sorted by window id */
+typedef struct {
+    Window window;
+    int slot;
+} TitleRef_t;
+
+static Title_t titles[TITLES_LEN];
+static int free_slots[TITLES_LEN];
+static int nb_free = 0;
+
+static TitleRef_t refs[TITLES_LEN];
+static int nb_refs = 0;
+
+static Trigram_t *trigrams = NULL;
+static int nb_trigrams = 0;         /* buckets used, some of them maybe empty */
+
+static Atom client_list_atom = None, net_name_atom = None, desktop_atom = None;
+static unsigned long activations = 0;
+
+static unsigned int
+trigram(const char *s)
+{
+    return ((unsigned char) s[0] << 16) | ((unsigned char) s[1] << 8) | (unsigned char) s[2];
+}
+
+/** Bucket of a trigram, NULL if missing and not to be created */
+static Trigram_t *
+find_trigram(unsigned int key, bool create)
+{
+    unsigned int i = (key * 2654435761U) >> 16;
+    Trigram_t *t;
+
+    for(;; i++) {
+        t = &trigrams[i & (TRIGRAMS_LEN - 1)];
+        if(t->key == key)
+            return t;
+        if(t->key == 0)
+            break;
+    }
+
+    if(!create)
+        return NULL;
+
+    t->key = key;
+    nb_trigrams++;
+    return t;
+}
+
+/** Add (or remove) a slot to (from) the lists of the trigrams of its text */
+static void
+index_text(int slot, bool add)
+{
+    const char *s = titles[slot].text;
+    Trigram_t *t;
+    int i, j;
+
+    for(i = 0; s[i] != '\0' && s[i+1] != '\0' && s[i+2] != '\0'; i++) {
+        if((t = find_trigram(trigram(s + i), add)) == NULL)
+            continue;
+
+        if(!add) {
+            for(j = 0; j < t->size && t->slots[j] != slot; j++)
+                ;
+            if(j < t->size)
+                t->slots[j] = t->slots[--t->size];
+            continue;
+        }
+
+        /* trigram seen earlier in the same text */
+        if(t->size > 0 && t->slots[t->size - 1] == slot)
+            continue;
+
+        if(t->size == t->capacity) {
+            t->capacity = MAX(4, 2 * t->capacity);
+            if((t->slots = (int *) realloc(t->slots, t->capacity * sizeof(int))) == NULL)
+                FATAL(("Could not allocate titles index"));
+        }
+        t->slots[t->size++] = slot;
+    }
+}
+
+/** Index every window again, dropping the trigrams no title has anymore */
+static void
+reindex()
+{
+    int i;
+
+    for(i = 0; i < TRIGRAMS_LEN; i++)
+        free(trigrams[i].slots);
+    memset(trigrams, 0, TRIGRAMS_LEN * sizeof(Trigram_t));
+    nb_trigrams = 0;
+
+    for(i = 0; i < TITLES_LEN; i++) {
+        if(titles[i].window != None)
+            index_text(i, true);
+    }
+
+    D(("Titles index rebuilt: %d trigrams", nb_trigrams));
+}
+
+/** Index the class and title of a slot, once either changed */
+static void
+update_text(int slot)
+{
+    Title_t *t = &titles[slot];
+    size_t length;
+    char *s;
+
+    /* keep probing short: buckets are never freed otherwise */
+    if(nb_trigrams > TRIGRAMS_LEN / 4 * 3)
+        reindex();
+
+    index_text(slot, false);
+
+    /* both fit, see TITLE_CLASS_LEN and TITLE_LEN */
+    length = strlen(t->class);
+    memcpy(t->text, t->class, length);
+    t->text[length] = ' ';
+    strcpy(t->text + length + 1, t->title);
+    for(s = t->text; *s != '\0'; s++)
+        *s = tolower((unsigned char) *s);
+
+    index_text(slot, true);
+}
+
+static void
+fetch_title(Title_t *t)
+{
+    t->net_name = get_window_string(event_display, t->window, "_NET_WM_NAME", t->title, TITLE_LEN);
+    if(!t->net_name)
+        get_window_string(event_display, t->window, "WM_NAME", t->title, TITLE_LEN);
+}
+
+static void
+fetch_class(Title_t *t)
+{
+    char instance[TITLE_CLASS_LEN];
+
+    get_window_class(event_display, t->window, instance, t->class, TITLE_CLASS_LEN);
+}
+
+/** Start indexing a window
+ * @return its slot, -1 if the index is full
+ */
+static int
+add_window(Window window)
+{
+    Title_t *t;
+    int slot;
+
+    if(nb_free == 0)
+        return -1;
+
+    slot = free_slots[--nb_free];
+    t = &titles[slot];
+    memset(t, 0, sizeof(Title_t));
+    t->window = window;
+
+    /* before reading them: changes in between are not missed */
+    XCALL(X_ONEWAY, "ChangeWindowAttributes", "CLIENT_EVENT_MASK", window,
+          XSelectInput(event_display, window, CLIENT_EVENT_MASK));
+
+    fetch_class(t);
+    fetch_title(t);
+    t->desktop = get_window_desktop(event_display, window);
+    update_text(slot);
+
+    return slot;
+}
+
+static void
+remove_window(int slot)
+{
+    index_text(slot, false);
+    titles[slot].window = None;
+    free_slots[nb_free++] = slot;
+}
+
+static int
+compare_window_ids(const void *a, const void *b)
+{
+    Window wa = * (const Window *) a, wb = * (const Window *) b;
+
+    return (wa > wb) - (wa < wb);
+}
+
+static int
+compare_refs(const void *a, const void *b)
+{
+    return compare_window_ids(&((const TitleRef_t *) a)->window, &((const TitleRef_t *) b)->window);
+}
+
+static TitleRef_t *
+find_ref(Window window)
+{
+    TitleRef_t key = {window, 0};
+
+    return (TitleRef_t *) bsearch(&key, refs, nb_refs, sizeof(TitleRef_t), compare_refs);
+}
+
+/**
+ * Follow <code>_NET_CLIENT_LIST</code>: index the windows appearing,
+ * forget the ones gone
+ */
+static void
+update_clients()
+{
+    static TitleRef_t merged[TITLES_LEN];
+    Atom actual_type;
+    int actual_format, status, i = 0, j = 0, n = 0, slot;
+    unsigned long nitems = 0, bytes_after;
+    unsigned char *data = NULL;
+    Window *list;
+
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_CLIENT_LIST", None,
+          status = XGetWindowProperty(event_display, XDefaultRootWindow(event_display),
+                                      client_list_atom, 0, (~0L), 0, XA_WINDOW,
+                                      &actual_type, &actual_format, &nitems, &bytes_after, &data));
+    if(status != Success || actual_type != XA_WINDOW || actual_format != 32)
+        nitems = 0;
+
+    list = (Window *) data;
+    if(nitems > 0)
+        qsort(list, nitems, sizeof(Window), compare_window_ids);
+
+    /* both lists sorted by id */
+    while(i < nb_refs || j < nitems) {
+        if(j > 0 && j < nitems && list[j] == list[j-1]) {
+            j++;
+        } else if(j == nitems || (i < nb_refs && refs[i].window < list[j])) {
+            remove_window(refs[i++].slot);
+        } else if(i == nb_refs || list[j] < refs[i].window) {
+            if((slot = add_window(list[j])) >= 0) {
+                merged[n].window = list[j];
+                merged[n++].slot = slot;
+            }
+            j++;
+        } else {
+            merged[n++] = refs[i++];
+            j++;
+        }
+    }
+
+    memcpy(refs, merged, n * sizeof(TitleRef_t));
+    nb_refs = n;
+
+    XFree(data);
+}
+
+/**
+ * Index the client windows, and keep doing so
+ * @note does nothing unless the socket or the status page is enabled
+ */
+void
+init_titles()
+{
+    int i;
+
+    if(settings.socket_file[0] == '\0' && settings.status_file[0] == '\0')
+        return;
+
+    if((trigrams = (Trigram_t *) calloc(TRIGRAMS_LEN, sizeof(Trigram_t))) == NULL)
+        FATAL(("Could not allocate titles index"));
+
+    for(i = 0; i < TITLES_LEN; i++)
+        free_slots[i] = TITLES_LEN - 1 - i;
+    nb_free = TITLES_LEN;
+
+    client_list_atom = get_atom(event_display, "_NET_CLIENT_LIST");
+    net_name_atom = get_atom(event_display, "_NET_WM_NAME");
+    desktop_atom = get_atom(event_display, "_NET_WM_DESKTOP");
+
+    update_clients();
+    titles_active(tracked_active_window());
+
+    INFO(("%d windows indexed, %d trigrams", nb_refs, nb_trigrams));
+}
+
+/**
+ * Update the index from a PropertyNotify
+ * @note event loop only
+ */
+void
+titles_event(XEvent *event)
+{
+    TitleRef_t *ref;
+    Title_t *t;
+    Atom atom = event->xproperty.atom;
+
+    if(trigrams == NULL || event->type != PropertyNotify)
+        return;
+
+    if(event->xproperty.window == XDefaultRootWindow(event_display)) {
+        if(atom == client_list_atom)
+            update_clients();
+        return;
+    }
+
+    if((ref = find_ref(event->xproperty.window)) == NULL)
+        return;
+
+    t = &titles[ref->slot];
+    if(atom == net_name_atom || (atom == XA_WM_NAME && !t->net_name)) {
+        fetch_title(t);
+        update_text(ref->slot);
+    } else if(atom == XA_WM_CLASS) {
+        fetch_class(t);
+        update_text(ref->slot);
+    } else if(atom == desktop_atom) {
+        t->desktop = get_window_desktop(event_display, t->window);
+    }
+}
+
+/**
+ * Window just activated: listed first from now on
+ * @note event loop only
+ */
+void
+titles_active(Window window)
+{
+    TitleRef_t *ref;
+
+    if(trigrams != NULL && (ref = find_ref(window)) != NULL)
+        titles[ref->slot].stamp = ++activations;
+}
+
+/** Indexed window, NULL if not indexed */
+const Title_t *
+get_title(Window window)
+{
+    TitleRef_t *ref;
+
+    if(trigrams == NULL || (ref = find_ref(window)) == NULL)
+        return NULL;
+
+    return &titles[ref->slot];
+}
+
+/**
+ * Number of windows on each desktop
+ * @param[out] counts   of desktops 0 to n - 1
+ */
+void
+count_desktops(int *counts, int n)
+{
+    int i, desktop;
+
+    memset(counts, 0, n * sizeof(int));
+
+    for(i = 0; i < nb_refs; i++) {
+        desktop = titles[refs[i].slot].desktop;
+        if(desktop >= 0 && desktop < n)
+            counts[desktop]++;
+    }
+}
+
+/**
+ * Windows whose class or title contains a text, case insensitive
+ *
+ * @param[out] matches  room for max entries, most recently active first,
+ *                      valid until the index changes
+ * @return number of matches, max at most
+ * @note event loop only
+ */
+int
+find_titles(const char *text, const Title_t **matches, int max)
+{
+    char folded[TITLE_LEN];
+    const int *candidates = NULL;
+    Trigram_t *t, *rarest = NULL;
+    int i, j, nb_candidates, nb_found = 0, length;
+
+    if(trigrams == NULL || max <= 0)
+        return 0;
+
+    for(length = 0; text[length] != '\0' && length < TITLE_LEN - 1; length++)
+        folded[length] = tolower((unsigned char) text[length]);
+    folded[length] = '\0';
+
+    /* windows listed under every trigram of the text: check the shortest list */
+    for(i = 0; i + 2 < length; i++) {
+        if((t = find_trigram(trigram(folded + i), false)) == NULL || t->size == 0)
+            return 0;
+        if(rarest == NULL || t->size < rarest->size)
+            rarest = t;
+    }
+
+    if(rarest != NULL) {
+        candidates = rarest->slots;
+        nb_candidates = rarest->size;
+    } else {
+        nb_candidates = nb_refs;
+    }
+
+    /* keep the max most recently active, by insertion: few ever were */
+    for(i = 0; i < nb_candidates; i++) {
+        const Title_t *t = &titles[candidates ? candidates[i] : refs[i].slot];
+
+        if(strstr(t->text, folded) == NULL
+                || (nb_found == max && t->stamp <= matches[max - 1]->stamp))
+            continue;
+
+        for(j = MIN(nb_found, max - 1); j > 0 && matches[j - 1]->stamp < t->stamp; j--)
+            matches[j] = matches[j - 1];
+        matches[j] = t;
+        nb_found = MIN(nb_found + 1, max);
+    }
+
+    return nb_found;
+}
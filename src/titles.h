@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef TITLES_H
+#define TITLES_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Titles
+
+  Launchers switch to a window by typing part of its title or class
+  (see @ref Ipc). Titles and classes of the client windows are kept in
+  memory and indexed by trigrams (three byte sequences, ASCII case folded):
+  a lookup only checks the windows listed under the rarest trigram of the
+  text searched for. Texts shorter than a trigram are looked for in every
+  window.
+
+  The index follows <code>_NET_CLIENT_LIST</code> on the root window and
+  <code>WM_NAME</code>, <code>_NET_WM_NAME</code>, <code>WM_CLASS</code>
+  and <code>_NET_WM_DESKTOP</code> on the clients: only the windows
+  appearing and the properties changing are queried, once, on the event
+  loop's own connection. Desktops are kept for the @ref Status page.
+
+  Matches come most recently active first.
+
+  @note the index belongs to the event loop, and is only kept when the
+  socket or the status page is enabled
+  */
+
+/** windows indexed at most */
+#define TITLES_LEN          4096
+#define TITLE_LEN           256
+#define TITLE_CLASS_LEN     64
+
+/** trigram buckets, a power of two */
+#define TRIGRAMS_LEN        65536
+
+/** indexed window
+ * @struct Title_t
+ */
+typedef struct {
+    Window window;          /**< None for a free slot */
+    char class[TITLE_CLASS_LEN];
+    char title[TITLE_LEN];
+    char text[TITLE_CLASS_LEN + TITLE_LEN]; /**< class and title, folded: what is indexed */
+    int desktop;            /**< <code>_NET_WM_DESKTOP</code> */
+    bool net_name;          /**< has a <code>_NET_WM_NAME</code>, <code>WM_NAME</code> is ignored */
+    unsigned long stamp;    /**< last time the window was active */
+} Title_t;
+
+void init_titles();
+void titles_event(XEvent *);
+void titles_active(Window);
+const Title_t *get_title(Window);
+void count_desktops(int *, int);
+int find_titles(const char *, const Title_t **, int);
+
+#endif /* TITLES_H */
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "callbacks.h"
+#include "trace.h"
+#include "pace.h"
+
+/** recorded request or action */
+typedef struct {
+    const char *name;           /**< request name, or binding name for actions */
+    const char *detail;         /**< atom/property, NULL if none */
+    Window window;
+    int type;                   /**< X_ROUNDTRIP, X_ONEWAY or -1 for an action */
+    int tid;
+    unsigned long long start;   /**< ns */
+    unsigned long long duration;/**< ns */
+    unsigned long roundtrips;   /**< actions only */
+    unsigned long oneway;       /**< actions only */
+} TraceEvent_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static TraceEvent_t *events = NULL;
+static int nb_events = 0;
+static unsigned long dropped = 0;
+
+/* per binding sums, plus requests made outside of any action */
+static XCounters_t stats[MOVESLEN + 1];
+
+/* action in progress (worker thread) */
+static XCounters_t action;
+static Move_t action_move = MOVESLEN;
+static Window action_window = None;
+static unsigned long long action_start = 0;
+static __thread bool in_action = false;
+static __thread int tid = 0;
+
+static int
+get_tid()
+{
+    if(tid == 0)
+        tid = (int) syscall(SYS_gettid);
+    return tid;
+}
+
+static void
+record(const char *name, const char *detail, Window window, int type,
+       unsigned long long start, unsigned long long duration)
+{
+    if(settings.trace_file[0] == '\0')
+        return;
+
+    if(events == NULL && (events = malloc(TRACE_MAX_EVENTS * sizeof(TraceEvent_t))) == NULL)
+        return;
+
+    if(nb_events >= TRACE_MAX_EVENTS) {
+        dropped++;
+        return;
+    }
+
+    TraceEvent_t *e = &events[nb_events++];
+    e->name = name;
+    e->detail = detail;
+    e->window = window;
+    e->type = type;
+    e->tid = get_tid();
+    e->start = start;
+    e->duration = duration;
+    e->roundtrips = action.roundtrips;
+    e->oneway = action.oneway;
+}
+
+/**
+ * Monotonic clock, in nanoseconds
+ */
+unsigned long long
+trace_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Account for an X request
+ * @see XCALL
+ */
+void
+trace_request(int type, const char *request, const char *detail, Window window, unsigned long long start)
+{
+    unsigned long long duration = trace_now() - start;
+    XCounters_t *counters = in_action ? &action : &stats[MOVESLEN];
+
+    pthread_mutex_lock(&lock);
+
+    if(type == X_ROUNDTRIP)
+        counters->roundtrips++;
+    else
+        counters->oneway++;
+    counters->x_ns += duration;
+
+    record(request, detail, window, type, start, duration);
+
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Account for client windows scanned by the action in progress
+ * Budgets are expressed partly per window.
+ */
+void
+trace_windows(int n)
+{
+    if(in_action)
+        action.windows += n;
+}
+
+/**
+ * Account for windows resized by the action in progress with a sync
+ * request: their extra requests come on top of the callback budget.
+ */
+void
+trace_paced(int n)
+{
+    if(in_action)
+        action.paced += n;
+}
+
+/**
+ * Check X requests counters of an action against its callback budget
+ * @return false if the budget is exceeded (fatal with STRICT_BUDGETS)
+ * @see Budget_t
+ */
+bool
+check_budget(Move_t move, const XCounters_t *counters)
+{
+    const Budget_t *b = &budgets[move];
+    unsigned long max_roundtrips = b->roundtrips + b->roundtrips_per_window * counters->windows
+                                   + PACE_ROUNDTRIPS * counters->paced;
+    unsigned long max_requests = b->requests + b->requests_per_window * counters->windows
+                                 + PACE_REQUESTS * counters->paced;
+
+    if(counters->roundtrips <= max_roundtrips
+            && counters->roundtrips + counters->oneway <= max_requests)
+        return true;
+
+#ifdef STRICT_BUDGETS
+    FATAL(("\"%s\" over budget: %lu/%lu round trips, %lu/%lu requests (%lu windows)",
+           bindings_reference[move].name,
+           counters->roundtrips, max_roundtrips,
+           counters->roundtrips + counters->oneway, max_requests, counters->windows));
+#else
+    WARN(("\"%s\" over budget: %lu/%lu round trips, %lu/%lu requests (%lu windows)",
+       bindings_reference[move].name,
+       counters->roundtrips, max_roundtrips,
+       counters->roundtrips + counters->oneway, max_requests, counters->windows));
+#endif
+    return false;
+}
+
+/**
+ * Group following requests of the calling thread under an action
+ */
+void
+trace_begin_action(Move_t move, Window window)
+{
+    pthread_mutex_lock(&lock);
+    memset(&action, 0, sizeof(action));
+    action_move = move;
+    action_window = window;
+    action_start = trace_now();
+    in_action = true;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Close the action in progress and add its counters to the binding stats
+ */
+void
+trace_end_action()
+{
+    pthread_mutex_lock(&lock);
+
+    action.actions = 1;
+    action.total_ns = trace_now() - action_start;
+    in_action = false;
+
+    stats[action_move].actions++;
+    stats[action_move].roundtrips += action.roundtrips;
+    stats[action_move].oneway += action.oneway;
+    stats[action_move].x_ns += action.x_ns;
+    stats[action_move].total_ns += action.total_ns;
+
+    record(bindings_reference[action_move].name, NULL, action_window, -1, action_start, action.total_ns);
+
+    pthread_mutex_unlock(&lock);
+
+    if(!check_budget(action_move, &action)) {
+        pthread_mutex_lock(&lock);
+        action.over_budget = 1;
+        stats[action_move].over_budget++;
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+/**
+ * Counters of the last completed action (or the one in progress)
+ * @note only meaningful from the worker thread
+ */
+const XCounters_t *
+get_action_counters()
+{
+    return &action;
+}
+
+/**
+ * Write recorded requests as a Chrome trace-event JSON file
+ * Recording goes on, the file holds everything since startup.
+ *
+ * @param filename  output file, nothing done if empty
+ */
+void
+trace_dump(const char *filename)
+{
+    FILE *fd;
+    int i;
+
+    if(filename == NULL || filename[0] == '\0')
+        return;
+
+    if((fd = fopen(filename, "w")) == NULL) {
+        WARN(("Unable to open \"%s\"", filename));
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    fprintf(fd, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(i = 0; i < nb_events; i++) {
+        TraceEvent_t *e = &events[i];
+
+        fprintf(fd, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"window\":\"0x%lx\"",
+                (i == 0 ? "" : ",\n"), e->name,
+                (e->type == -1 ? "action" : (e->type == X_ROUNDTRIP ? "roundtrip" : "oneway")),
+                (int) getpid(), e->tid, e->start / 1000.0, e->duration / 1000.0, e->window);
+
+        if(e->detail != NULL)
+            fprintf(fd, ",\"detail\":\"%s\"", e->detail);
+        if(e->type == -1)
+            fprintf(fd, ",\"roundtrips\":%lu,\"oneway\":%lu", e->roundtrips, e->oneway);
+
+        fprintf(fd, "}}");
+    }
+    fprintf(fd, "\n],\"otherData\":{\"dropped\":%lu}}\n", dropped);
+
+    pthread_mutex_unlock(&lock);
+
+    fclose(fd);
+    D(("%d events written to \"%s\"", nb_events, filename));
+}
+
+/**
+ * Print X requests counters for each binding
+ * Averages are given per action.
+ */
+void
+print_stats()
+{
+    int i;
+
+    pthread_mutex_lock(&lock);
+
+    printf(COLOR_BOLD"Statistics:\n"COLOR_CLEAR
+           "  - %-16s %8s %12s %12s %10s %10s %8s\n",
+           "action", "count", "roundtrips", "oneway", "X (us)", "total (us)", "over");
+
+    for(i = 0; i <= MOVESLEN; i++) {
+        XCounters_t *s = &stats[i];
+        unsigned long n = (s->actions > 0 ? s->actions : 1);
+
+        if(s->actions == 0 && s->roundtrips == 0 && s->oneway == 0)
+            continue;
+
+        printf("  - %-16s %8lu %12.1f %12.1f %10.1f %10.1f %8lu\n",
+               (i == MOVESLEN ? "(event loop)" : bindings_reference[i].name), s->actions,
+               (double) s->roundtrips / n, (double) s->oneway / n,
+               s->x_ns / 1000.0 / n, s->total_ns / 1000.0 / n, s->over_budget);
+    }
+
+    pthread_mutex_unlock(&lock);
+}
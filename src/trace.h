@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Trace
+
+  Every X request issued by tiler goes through the XCALL() macro, which
+  counts it (round trip or one-way) and times it. Requests are grouped under
+  the action that caused them, between trace_begin_action() and
+  trace_end_action().
+
+  Counters are always on and summed up per binding (print_stats()). When a
+  trace file is given (<code>--trace</code>), every request is also recorded
+  and written as a Chrome trace-event JSON file on SIGUSR1 and at exit, to be
+  opened in chrome://tracing or Perfetto.
+
+  When an action ends, its counters are checked against the budget declared
+  by its callback (check_budget()).
+  */
+
+#define X_ONEWAY    0
+#define X_ROUNDTRIP 1
+
+/** maximum number of recorded requests, older ones are kept */
+#define TRACE_MAX_EVENTS 65536
+
+/** X requests counters
+ * @struct XCounters_t
+ */
+typedef struct {
+    unsigned long actions;      /**< number of actions summed up */
+    unsigned long roundtrips;   /**< requests waiting for a reply */
+    unsigned long oneway;       /**< requests only buffered */
+    unsigned long windows;      /**< client windows scanned */
+    unsigned long paced;        /**< windows resized with a sync request @see pace_geometries */
+    unsigned long over_budget;  /**< actions over their budget @see check_budget */
+    unsigned long long x_ns;    /**< time spent in Xlib calls */
+    unsigned long long total_ns;/**< total time of the actions */
+} XCounters_t;
+
+/**
+ * Issue an X request, count and time it
+ * @param type      X_ROUNDTRIP or X_ONEWAY
+ * @param request   request name ("GetProperty"...)
+ * @param detail    atom or property involved (string literal), NULL if none
+ * @param window    window involved, None if none
+ * @param call      the actual Xlib statement
+ */
+#define XCALL(type, request, detail, window, call) do {                 \
+    unsigned long long __start = trace_now();                           \
+    call;                                                               \
+    trace_request((type), (request), (detail), (window), __start);      \
+  } while(0)
+
+unsigned long long trace_now();
+void trace_request(int, const char *, const char *, Window, unsigned long long);
+
+void trace_windows(int);
+void trace_paced(int);
+void trace_begin_action(Move_t, Window);
+void trace_end_action();
+const XCounters_t *get_action_counters();
+bool check_budget(Move_t, const XCounters_t *);
+
+void trace_dump(const char *);
+void print_stats();
+
+#endif /* TRACE_H */
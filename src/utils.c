@@ -17,3 +17,147 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "utils.h"
+
+/** runtime verbosity, messages above are skipped */
+int log_verbosity = LOG_WARN;
+
+static const char *log_colors[] = {COLOR_RED, COLOR_YELLOW, COLOR_GREEN, COLOR_BLUE};
+
+/* line being formatted by the calling thread */
+static __thread char line[LOG_LINE_LEN];
+static __thread int line_len = 0;
+
+/* lines waiting to be written */
+static char ring[LOG_RING_LEN][LOG_LINE_LEN];
+static int ring_head = 0, ring_size = 0;
+static unsigned long dropped = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static bool logger_running = false;
+
+/**
+ * Start a log line
+ * @see LOG
+ */
+void
+log_begin(int level, const char *file, const char *function, int lineno)
+{
+    line_len = 0;
+    log_append("%s[%s:%s(%d)]%s ", log_colors[level], file, function, lineno, COLOR_CLEAR);
+}
+
+/**
+ * Append to the log line in progress, truncated to LOG_LINE_LEN
+ */
+void
+log_append(const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    if(line_len >= LOG_LINE_LEN - 1)
+        return;
+
+    va_start(args, format);
+    n = vsnprintf(line + line_len, LOG_LINE_LEN - 1 - line_len, format, args);
+    va_end(args);
+
+    if(n > 0)
+        line_len = MIN(line_len + n, LOG_LINE_LEN - 2);
+}
+
+/**
+ * Hand the log line over to the logger thread
+ * Never blocks on output: the line is dropped if the ring is full. Lines
+ * are written directly until the logger is started.
+ */
+void
+log_end()
+{
+    line[line_len++] = '\n';
+    line[line_len] = '\0';
+
+    pthread_mutex_lock(&lock);
+
+    if(!logger_running) {
+        fputs(line, stdout);
+    } else if(ring_size < LOG_RING_LEN) {
+        memcpy(ring[(ring_head + ring_size) % LOG_RING_LEN], line, line_len + 1);
+        ring_size++;
+        pthread_cond_signal(&wakeup);
+    } else {
+        dropped++;
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+static void *
+logger_loop(void *arg)
+{
+    char buffer[LOG_LINE_LEN];
+    unsigned long lost;
+    bool last;
+
+    pthread_mutex_lock(&lock);
+    for(;;) {
+        while(ring_size == 0)
+            pthread_cond_wait(&wakeup, &lock);
+
+        memcpy(buffer, ring[ring_head], LOG_LINE_LEN);
+        ring_head = (ring_head + 1) % LOG_RING_LEN;
+        ring_size--;
+        lost = dropped;
+        dropped = 0;
+        last = (ring_size == 0);
+
+        /* the actual (possibly blocking) write, unlocked */
+        pthread_mutex_unlock(&lock);
+        if(lost > 0)
+            printf("[log] %lu messages dropped\n", lost);
+        fputs(buffer, stdout);
+        if(last)
+            fflush(stdout);
+        pthread_mutex_lock(&lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Write log lines from a dedicated thread from now on
+ */
+void
+start_logger()
+{
+    pthread_t thread;
+
+    pthread_mutex_lock(&lock);
+    if(!logger_running && pthread_create(&thread, NULL, logger_loop, NULL) == 0) {
+        pthread_detach(thread);
+        logger_running = true;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Synchronously write pending log lines (before exiting)
+ */
+void
+flush_log()
+{
+    pthread_mutex_lock(&lock);
+    while(ring_size > 0) {
+        fputs(ring[ring_head], stdout);
+        ring_head = (ring_head + 1) % LOG_RING_LEN;
+        ring_size--;
+    }
+    fflush(stdout);
+    pthread_mutex_unlock(&lock);
+}
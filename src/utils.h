@@ -31,30 +31,82 @@
 
 #define STREQ(str1, str2) (strcmp((str1), (str2)) == 0)
 
-#define DEBUG 1
-#ifdef DEBUG
-#define D(msg) do {                                                     \
-    printf("%s[%s:%s(%d)]%s ",COLOR_YELLOW, __FILE__, __FUNCTION__, __LINE__, COLOR_CLEAR); \
-    printf msg;                                                         \
-    printf("\n");                                                       \
-  } while (0);
+/**
+ * @page Logging
+ *
+ * Messages have a level, from LOG_ERROR to LOG_DEBUG:
+ * @li levels above LOG_LEVEL (set at build time with -DLOG_LEVEL=n) are compiled out
+ * @li levels above log_verbosity (raised by each -v option) are skipped at runtime
+ *     for the price of a comparison
+ *
+ * Messages are formatted by the caller into a ring buffer and written by a
+ * dedicated thread (start_logger()), so that a slow or full stdout never blocks
+ * the event loop nor an action. Messages are dropped if the ring is full.
+ *
+ * Macros take a parenthesized printf-like list: D(("%d windows", n));
+ */
+#define LOG_ERROR   0
+#define LOG_WARN    1
+#define LOG_INFO    2
+#define LOG_DEBUG   3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL   LOG_DEBUG
+#endif
+
+#define LOG_RING_LEN    256
+#define LOG_LINE_LEN    256
+
+extern int log_verbosity;
+
+#define LOG(level, msg) do {                                            \
+    if((level) <= log_verbosity) {                                      \
+        log_begin((level), __FILE__, __FUNCTION__, __LINE__);           \
+        log_append msg;                                                 \
+        log_end();                                                      \
+    }                                                                   \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_DEBUG
+#define D(msg)      LOG(LOG_DEBUG, msg);
 #else
 #define D(msg)
 #endif
 
+#if LOG_LEVEL >= LOG_INFO
+#define INFO(msg)   LOG(LOG_INFO, msg);
+#else
+#define INFO(msg)
+#endif
+
+#if LOG_LEVEL >= LOG_WARN
+#define WARN(msg)   LOG(LOG_WARN, msg);
+#else
+#define WARN(msg)
+#endif
+
 #define FATAL(msg) do {                                                     \
-    printf("%s[%s:%s(%d)]%s ",COLOR_RED, __FILE__, __FUNCTION__, __LINE__, COLOR_CLEAR); \
-    printf msg;                                                         \
-    printf("\n");                                                       \
-    cleanup();                                                          \
-    exit(1);                                                            \
+    log_begin(LOG_ERROR, __FILE__, __FUNCTION__, __LINE__);                 \
+    log_append msg;                                                         \
+    log_end();                                                              \
+    flush_log();                                                            \
+    quit(1);                                                                \
   } while (0);
 
-#define TODO(msg) do {                                                     \
-    printf("%s[%s:%s(%d)] TODO: %s ",COLOR_BLUE, __FILE__, __FUNCTION__, __LINE__, COLOR_CLEAR); \
-    printf msg;                                                         \
-    printf("\n");                                                       \
-    } while(0);
+#define TODO(msg) do {                                                      \
+    if(LOG_DEBUG <= log_verbosity) {                                        \
+        log_begin(LOG_DEBUG, __FILE__, __FUNCTION__, __LINE__);             \
+        log_append("TODO: ");                                               \
+        log_append msg;                                                     \
+        log_end();                                                          \
+    }                                                                       \
+  } while(0);
+
+void log_begin(int, const char *, const char *, int);
+void log_append(const char *, ...) __attribute__((format(printf, 1, 2)));
+void log_end();
+void start_logger();
+void flush_log();
 
 #define FREE(ptr) if(ptr != NULL) {     \
     free(ptr);                          \
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <X11/Xlib.h>
+
+#include "tiler.h"
+#include "utils.h"
+#include "config.h"
+#include "keybindings.h"
+#include "xactions.h"
+#include "clients.h"
+#include "trace.h"
+#include "arena.h"
+#include "flight.h"
+#include "status.h"
+#include "ipc.h"
+#include "worker.h"
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle = PTHREAD_COND_INITIALIZER;
+
+/* pending actions, oldest first */
+static Action_t queue[WORKER_QUEUE_LEN];
+static int queue_size = 0;
+
+static bool started = false;
+static bool running = false;
+static bool held = false;
+static bool busy = false;
+static Action_t current;
+static volatile bool cancelled = false;
+
+static bool
+is_hop(Move_t m)
+{
+    return m == LEFTSCREEN || m == RIGHTSCREEN;
+}
+
+static bool
+is_split(Move_t m)
+{
+    return m == GROWSPLIT || m == SHRINKSPLIT;
+}
+
+static bool
+is_placement(Move_t m)
+{
+    return is_hop(m) || bindings_reference[m].callback == move;
+}
+
+/**
+ * Follow the monitors on the left/right of a monitor
+ * @return monitor reached after the given number of hops (stops on the last one)
+ */
+static int
+resolve_hops(int monitor, int hops)
+{
+    Move_t direction = (hops < 0) ? LEFTSCREEN : RIGHTSCREEN;
+    Monitor_t *next;
+
+    for(; hops != 0; hops += (hops < 0) ? 1 : -1) {
+        if((next = (Monitor_t *) bindings[monitor][direction].data) == NULL)
+            break;
+        monitor = next->id;
+    }
+
+    return monitor;
+}
+
+/**
+ * Call the binding of an action, on the monitor its target lives on
+ * @note runs on the worker thread, with the lock released
+ */
+static void
+run_action(Action_t action)
+{
+    Window win;
+    Client_t *client;
+
+    const XCounters_t *counters;
+    unsigned long long latency;
+
+    trace_begin_action(action.move, action.target);
+    drain_client_events(display);
+    flight_record(FLIGHT_BEGIN, action.move, action.target,
+                  (trace_now() - action.queued) / 1000, 0, 0, 0);
+
+    int monitor, destination;
+    Binding_t *binding;
+
+    /* trust our own placements rather than asking the server */
+    if(action.monitor >= 0)
+        monitor = action.monitor;
+    else if(action.move == RELAYOUT || action.move == SAVELAYOUT || action.move == RESTORELAYOUT)
+        monitor = 0;    /* covers every monitor, no window involved */
+    else {
+        win = (action.target != None) ? action.target : get_active_window();
+        client = get_client(win);
+
+        if(client != NULL && client->monitor >= 0)
+            monitor = client->monitor;
+        else
+            monitor = get_window_monitor(win);
+    }
+
+    destination = resolve_hops(monitor, action.hops);
+    binding = &bindings[destination][action.move];
+    current.monitor = destination;
+
+    if(is_hop(action.move)) {
+        /* net effect of the burst may be to stay where we are */
+        if(destination != monitor)
+            changescreen(&settings.monitors[destination]);
+    } else if(binding->callback != NULL) {
+        INFO((" > calling \"%s\"", binding->name));
+
+        binding->callback(binding->data);
+    }
+
+    /* nobody reads events on this connection, flush explicitly */
+    XFlush(display);
+
+    trace_end_action();
+
+    counters = get_action_counters();
+    flight_record(FLIGHT_END, action.move, action.target,
+                  counters->roundtrips, counters->roundtrips + counters->oneway,
+                  counters->x_ns / 1000, counters->total_ns / 1000);
+    latency = trace_now() - action.queued;
+    status_action(action.move, counters, latency);
+    ipc_publish("action %s %llu %lu %lu\n", bindings_reference[action.move].name, latency / 1000,
+                counters->roundtrips, counters->roundtrips + counters->oneway);
+
+    /* transient lists and snapshots of the action */
+    arena_reset();
+}
+
+/**
+ * Whether an action supersedes another one
+ * Desktop-wide actions (no target) only supersede actions of the same kind:
+ * a relayout must not cancel a grid, and the other way round.
+ */
+static bool
+same_target(Action_t a, Action_t b)
+{
+    return a.target == b.target && (a.target != None || a.move == b.move);
+}
+
+/**
+ * Merge a new action into a pending one with the same target
+ * @return false if both cancel each other (pending action to be removed)
+ */
+static bool
+coalesce(Action_t *pending, Action_t action)
+{
+    if(is_split(pending->move) && is_split(action.move)) {
+        pending->steps += action.steps;
+        pending->move = (pending->steps < 0) ? SHRINKSPLIT : GROWSPLIT;
+        return pending->steps != 0;
+    }
+
+    if(!is_placement(pending->move) || !is_placement(action.move)) {
+        action.queued = pending->queued;
+        *pending = action;
+        return true;
+    }
+
+    pending->hops += action.hops;
+
+    if(is_hop(action.move)) {
+        /* a zone move stays a zone move, on the destination monitor */
+        if(is_hop(pending->move))
+            pending->move = (pending->hops < 0) ? LEFTSCREEN : RIGHTSCREEN;
+    } else if(pending->move == action.move) {
+        /* same zone again: its size cycles once per press */
+        pending->presses += action.presses;
+    } else {
+        /* last zone wins */
+        pending->move = action.move;
+        pending->presses = action.presses;
+    }
+
+    return !(is_hop(pending->move) && pending->hops == 0);
+}
+
+static void *
+worker_loop(void *arg)
+{
+    Action_t action;
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for(;;) {
+        while(running && (queue_size == 0 || held))
+            pthread_cond_wait(&wakeup, &lock);
+
+        if(!running)
+            break;
+
+        action = queue[0];
+        for(i = 1; i < queue_size; i++)
+            queue[i-1] = queue[i];
+        queue_size--;
+
+        current = action;
+        cancelled = false;
+        busy = true;
+        pthread_mutex_unlock(&lock);
+
+        run_action(action);
+
+        pthread_mutex_lock(&lock);
+        busy = false;
+        if(queue_size == 0)
+            pthread_cond_broadcast(&idle);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+/**
+ * Start the worker thread
+ *
+ * From now on, the <code>display</code> connection belongs to the worker
+ * and must not be used by the main thread anymore.
+ */
+void
+start_worker()
+{
+    running = true;
+    if(pthread_create(&thread, NULL, worker_loop, NULL) != 0)
+        FATAL(("Could not start worker thread"));
+    started = true;
+}
+
+/**
+ * Ask the worker to stop and wait for the action in progress (if any),
+ * then give its arena back
+ */
+void
+stop_worker()
+{
+    if(started) {
+        pthread_mutex_lock(&lock);
+        running = false;
+        cancelled = true;
+        pthread_cond_signal(&wakeup);
+        pthread_mutex_unlock(&lock);
+
+        pthread_join(thread, NULL);
+        started = false;
+    }
+
+    /* joined (or never started): nothing allocates from it anymore */
+    arena_free();
+}
+
+/**
+ * End the worker thread from within, when it cannot go on (FATAL)
+ * Whoever waits for it is released, stop_worker() still has to join it.
+ * @note worker only, never returns
+ */
+void
+abort_worker()
+{
+    pthread_mutex_lock(&lock);
+    running = false;
+    busy = false;
+    pthread_cond_broadcast(&idle);
+    pthread_mutex_unlock(&lock);
+
+    pthread_exit(NULL);
+}
+
+/**
+ * Whether the calling thread is the worker
+ */
+bool
+on_worker()
+{
+    return started && pthread_equal(pthread_self(), thread);
+}
+
+/**
+ * Prevent the worker from picking new actions while a burst of events is
+ * being queued. The action in progress (if any) is not affected.
+ */
+void
+hold_worker()
+{
+    pthread_mutex_lock(&lock);
+    held = true;
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Let the worker process the (coalesced) queued actions
+ */
+void
+release_worker()
+{
+    pthread_mutex_lock(&lock);
+    held = false;
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Wait until every queued action has been executed
+ * Only used when replaying, where actions are run one at a time.
+ */
+void
+wait_worker()
+{
+    pthread_mutex_lock(&lock);
+    while(running && (queue_size > 0 || busy))
+        pthread_cond_wait(&idle, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Queue an action for the worker thread
+ *
+ * A pending action on the same target is superseded, or coalesced with the
+ * new one for placement actions, and a running one is cancelled.
+ *
+ * @param move      binding to be called
+ * @param target    window the action applies to, None for desktop-wide actions
+ * @note never blocks on X: safe to call from the event loop
+ */
+void
+queue_action(Move_t move, Window target)
+{
+    queue_action_on(move, target, -1);
+}
+
+/**
+ * Queue an action for the worker thread, on a given monitor
+ * @param monitor   monitor to execute the action on, -1 for the target's one
+ * @see queue_action
+ */
+void
+queue_action_on(Move_t move, Window target, int monitor)
+{
+    Action_t action = {move, target, 0, monitor, 0, 0, trace_now()};
+    int i;
+
+    flight_record(FLIGHT_QUEUED, move, target, 0, 0, 0, 0);
+
+    if(move == LEFTSCREEN)
+        action.hops = -1;
+    else if(move == RIGHTSCREEN)
+        action.hops = 1;
+    else if(move == GROWSPLIT)
+        action.steps = 1;
+    else if(move == SHRINKSPLIT)
+        action.steps = -1;
+    else if(is_placement(move))
+        action.presses = 1;
+
+    pthread_mutex_lock(&lock);
+
+    if(busy && same_target(current, action))
+        cancelled = true;
+
+    for(i = 0; i < queue_size; i++) {
+        if(same_target(queue[i], action))
+            break;
+    }
+
+    if(i < queue_size) {
+        D(("coalescing \"%s\" into \"%s\"", bindings_reference[move].name, bindings_reference[queue[i].move].name));
+        if(!coalesce(&queue[i], action)) {
+            for(i++; i < queue_size; i++)
+                queue[i-1] = queue[i];
+            queue_size--;
+        }
+    } else if(queue_size < WORKER_QUEUE_LEN) {
+        queue[queue_size++] = action;
+    } else {
+        WARN(("worker queue full, dropping \"%s\"", bindings_reference[move].name));
+    }
+
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Whether the running action has been superseded by a newer one
+ * Long running callbacks should check it between X requests and give up.
+ */
+bool
+action_cancelled()
+{
+    return cancelled;
+}
+
+/**
+ * Action being executed by the worker
+ * @note only meaningful from a callback (worker thread)
+ */
+const Action_t *
+get_current_action()
+{
+    return &current;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2012 Manuel Vonthron <manuel.vonthron@acadis.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <X11/Xlib.h>
+#include "tiler.h"
+#include "utils.h"
+
+/**
+  @page Worker
+
+  Callbacks may issue a lot of synchronous requests (list_windows() queries
+  every client) and a single unresponsive client is enough to stall them.
+  They are therefore executed by a worker thread owning the <code>display</code>
+  connection, while the main thread only listens to key events on its own
+  <code>event_display</code> connection and queues actions.
+
+  Each queued action has a target (the active window, or <code>None</code> for
+  desktop-wide actions such as grid()). A newer action on the same target
+  replaces a pending one and cancels a running one: long loops check
+  action_cancelled() and bail out early.
+
+  Placement actions on the same target are coalesced into their net effect
+  instead: three "rightscreen" become a single hop of three monitors, a zone
+  move after a hop is applied on the destination monitor. The event loop
+  holds the worker (hold_worker()) while it drains a burst of events so the
+  whole burst is coalesced before anything is executed. Split resizes add up
+  the same way: three "growsplit" and a "shrinksplit" grow by two steps.
+  Presses of the same zone are counted, so that the size still cycles once
+  per press.
+  */
+
+/** queued action
+ * @struct Action_t
+ */
+typedef struct {
+    Move_t move;        /**< binding to be called */
+    Window target;      /**< window the action applies to, None for desktop-wide actions */
+    int hops;           /**< net number of monitors to move to first, negative means leftwards */
+    int monitor;        /**< monitor the action is executed on, resolved by the worker */
+    int steps;          /**< net growsplit steps, negative means shrinking */
+    int presses;        /**< presses of the same zone, each one cycling its size */
+    unsigned long long queued;  /**< time the (first coalesced) action was queued */
+} Action_t;
+
+#define WORKER_QUEUE_LEN 32
+
+void start_worker();
+void stop_worker();
+void abort_worker();
+bool on_worker();
+void hold_worker();
+void release_worker();
+void wait_worker();
+void queue_action(Move_t, Window);
+void queue_action_on(Move_t, Window, int);
+bool action_cancelled();
+const Action_t *get_current_action();
+
+#endif /* WORKER_H */
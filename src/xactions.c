@@ -19,6 +19,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
@@ -28,9 +29,62 @@
 #include "utils.h"
 #include "xactions.h"
 #include "config.h"
+#include "worker.h"
+#include "trace.h"
+#include "arena.h"
+#include "clients.h"
+#include "pace.h"
+#include "corrections.h"
+#include "neighbours.h"
+
+/* the WM handles _NET_MOVERESIZE_WINDOW, see check_wm_support() */
+static bool supports_moveresize = false;
 
 #define MATCH(condition, state) (((condition) && (state)) || (!condition))
 
+#define ATOM_CACHE_LEN 64
+
+/**
+ * Atoms are interned once and for all: their value is the same on every
+ * connection, we only pay the round trip on first use.
+ * @param name  atom name, compared by address first (string literals)
+ */
+Atom
+get_atom(Display *display, const char *name)
+{
+    static struct {
+        const char *name;
+        Atom atom;
+    } cache[ATOM_CACHE_LEN];
+    static int size = 0;
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    int i;
+    Atom atom = None;
+
+    /* shared by the event loop and the worker */
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < size && atom == None; i++)
+        if(cache[i].name == name || STREQ(cache[i].name, name))
+            atom = cache[i].atom;
+    pthread_mutex_unlock(&lock);
+
+    if(atom != None)
+        return atom;
+
+    XCALL(X_ROUNDTRIP, "InternAtom", name, None,
+          atom = XInternAtom(display, name, 0));
+
+    pthread_mutex_lock(&lock);
+    if(size < ATOM_CACHE_LEN) {
+        cache[size].atom = atom;
+        cache[size].name = name;
+        size++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return atom;
+}
+
 /**
  * property getters
  */
@@ -43,10 +97,11 @@ get_int_property(Display *display, Window window, char *property)
     unsigned char *data = NULL;
 
 
-    at = XInternAtom(display, property, 0);
-    status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
-                                XA_CARDINAL, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
+    at = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
 
     if(status >= Success
             && nitems >= 1
@@ -69,10 +124,11 @@ get_2int_property(Display *display, Window window, char *property, int *data0, i
     unsigned char *data = NULL;
 
 
-    at = XInternAtom(display, property, 0);
-    status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
-                                XA_CARDINAL, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
+    at = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
     if(status >= Success
             && nitems >= 2
             && actual_type == XA_CARDINAL
@@ -97,10 +153,11 @@ get_4int_property(Display *display, Window window, char *property, int *data0, i
     unsigned char *data = NULL;
 
 
-    at = XInternAtom(display, property, 0);
-    status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
-                                XA_CARDINAL, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
+    at = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
     if(status >= Success
             && nitems >= 4
             && actual_type == XA_CARDINAL
@@ -128,10 +185,11 @@ get_property(Display *display, Window window, char *property, void *data)
     int actual_format, status = -1;
     unsigned long nitems, bytes_after;
 
-    atom = XInternAtom(display, property, 0);
-    status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
-                                AnyPropertyType, &actual_type, &actual_format,
-                                &nitems, &bytes_after, (unsigned char **)&data);
+    atom = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
+                                      AnyPropertyType, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, (unsigned char **)&data));
 
     if(status >= Success && nitems > 0)
         return nitems;
@@ -139,29 +197,36 @@ get_property(Display *display, Window window, char *property, void *data)
         return -1;
 }
 
-static Atom
-get_atom_property(Window window, char *property)
+/** Read an atom list property as a bit mask
+ * @param[in] names     atoms of the bits, in order
+ * @return bits of the atoms present in the list (others are ignored)
+ */
+static unsigned int
+get_atom_mask(Display *display, Window window, char *property, const char * const *names, int nb_names)
 {
-    Atom at, actual_type, value;
-    int actual_format, status;
-    unsigned long nitems, bytes_after;
+    Atom at, actual_type;
+    int actual_format, status, i, j;
+    unsigned long nitems = 0, bytes_after;
     unsigned char *data = NULL;
+    unsigned int mask = 0;
 
-    at = XInternAtom(display, property, 0);
-    status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
-                                XA_ATOM, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
-
-    if(status >= Success
-            && nitems >= 1
-            && actual_type == XA_ATOM
-            && actual_format == 32) {
+    at = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, at, 0, (~0L), 0,
+                                      XA_ATOM, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
 
-        value = *((int *)data);
+    if(status == Success && actual_type == XA_ATOM && actual_format == 32) {
+        for(i = 0; i < nitems; i++) {
+            for(j = 0; j < nb_names; j++) {
+                if(((Atom *) data)[i] == get_atom(display, names[j]))
+                    mask |= 1 << j;
+            }
+        }
     }
 
-  XFree(data);
-  return value;
+    XFree(data);
+    return mask;
 }
 
 /**
@@ -225,23 +290,110 @@ __compiz_get_window_adjustments(Window window, int *x, int *y, int *width, int *
 
 /*
  */
-static bool
-is_regular_window(Window window)
+/** EWMH names of the window types, in WindowType_t order */
+static const char * const type_atoms[NB_WINDOW_TYPES] = {
+    "_NET_WM_WINDOW_TYPE_DESKTOP",
+    "_NET_WM_WINDOW_TYPE_DOCK",
+    "_NET_WM_WINDOW_TYPE_TOOLBAR",
+    "_NET_WM_WINDOW_TYPE_MENU",
+    "_NET_WM_WINDOW_TYPE_UTILITY",
+    "_NET_WM_WINDOW_TYPE_SPLASH",
+    "_NET_WM_WINDOW_TYPE_DIALOG",
+    "_NET_WM_WINDOW_TYPE_NORMAL",
+};
+
+/** EWMH names of the window states, in WindowState_t order */
+static const char * const state_atoms[NB_WINDOW_STATES] = {
+    "_NET_WM_STATE_MODAL",
+    "_NET_WM_STATE_STICKY",
+    "_NET_WM_STATE_MAXIMIZED_VERT",
+    "_NET_WM_STATE_MAXIMIZED_HORZ",
+    "_NET_WM_STATE_SHADED",
+    "_NET_WM_STATE_SKIP_TASKBAR",
+    "_NET_WM_STATE_SKIP_PAGER",
+    "_NET_WM_STATE_HIDDEN",
+    "_NET_WM_STATE_FULLSCREEN",
+    "_NET_WM_STATE_ABOVE",
+    "_NET_WM_STATE_BELOW",
+    "_NET_WM_STATE_DEMANDS_ATTENTION",
+};
+
+/** short names of the types and states, as used in rules */
+const char * const window_type_names[NB_WINDOW_TYPES] = {
+    "desktop", "dock", "toolbar", "menu", "utility", "splash", "dialog", "normal",
+};
+
+const char * const window_state_names[NB_WINDOW_STATES] = {
+    "modal", "sticky", "maximized_vert", "maximized_horz", "shaded", "skip_taskbar",
+    "skip_pager", "hidden", "fullscreen", "above", "below", "demands_attention",
+};
+
+/** All types of a window (<code>_NET_WM_WINDOW_TYPE</code> is a list,
+ * by order of preference)
+ * @return mask of (1 << WindowType_t)
+ */
+unsigned int
+get_window_types(Display *display, Window window)
 {
-    Atom state = get_atom_property(window, "_NET_WM_STATE");
-    Atom atom_sticky = XInternAtom(display, "_NET_WM_STATE_STICKY", 0);
-    if(state == atom_sticky)
-        return false;
+    return get_atom_mask(display, window, "_NET_WM_WINDOW_TYPE", type_atoms, NB_WINDOW_TYPES);
+}
 
-    Atom type = get_atom_property(window, "_NET_WM_WINDOW_TYPE");
-    Atom atom_normal = XInternAtom(display, "_NET_WM_WINDOW_TYPE_NORMAL", 0);
-    Atom atom_utility = XInternAtom(display, "_NET_WM_WINDOW_TYPE_UTILITY", 0);
-    Atom atom_dialog = XInternAtom(display, "_NET_WM_WINDOW_TYPE_DIALOG", 0);
+/** @return mask of (1 << WindowState_t) */
+unsigned int
+get_window_states(Display *display, Window window)
+{
+    return get_atom_mask(display, window, "_NET_WM_STATE", state_atoms, NB_WINDOW_STATES);
+}
 
-    if(type == atom_normal || type == atom_utility || type == atom_dialog)
-        return true;
-    else
+/** Replace an atom list property from a mask of atom names
+ * @see get_atom_mask
+ */
+static void
+set_atom_mask(Display *display, Window window, char *property, const char * const *names, int nb_names, unsigned int mask)
+{
+    Atom atoms[32];
+    int i, n = 0;
+
+    for(i = 0; i < nb_names; i++) {
+        if(mask & (1 << i))
+            atoms[n++] = get_atom(display, names[i]);
+    }
+
+    XCALL(X_ONEWAY, "ChangeProperty", property, window,
+          XChangeProperty(display, window, get_atom(display, property), XA_ATOM, 32,
+                          PropModeReplace, (unsigned char *) atoms, n));
+}
+
+/** Set the types of a window we own (replayed clients)
+ * @see get_window_types
+ */
+void
+set_window_types(Display *display, Window window, unsigned int types)
+{
+    set_atom_mask(display, window, "_NET_WM_WINDOW_TYPE", type_atoms, NB_WINDOW_TYPES, types);
+}
+
+/** @see set_window_types */
+void
+set_window_states(Display *display, Window window, unsigned int states)
+{
+    set_atom_mask(display, window, "_NET_WM_STATE", state_atoms, NB_WINDOW_STATES, states);
+}
+
+/** Whether a window is to be tiled, from its types and states */
+bool
+is_regular(unsigned int types, unsigned int states)
+{
+    if(states & (1 << STATE_STICKY))
         return false;
+
+    return types & ((1 << WINDOW_NORMAL) | (1 << WINDOW_UTILITY) | (1 << WINDOW_DIALOG));
+}
+
+static bool
+is_regular_window(Window window)
+{
+    return is_regular(get_window_types(display, window), get_window_states(display, window));
 }
 
 
@@ -251,9 +403,16 @@ is_regular_window(Window window)
 Window
 get_active_window()
 {
-    extern Display *display;
+    return get_display_active_window(display);
+}
 
-    Atom atom = XInternAtom(display, "_NET_ACTIVE_WINDOW", 0);
+/** Read <code>_NET_ACTIVE_WINDOW</code> through a given connection
+ * Used by the event loop, which does not own <code>display</code>.
+ */
+Window
+get_display_active_window(Display *display)
+{
+    Atom atom = get_atom(display, "_NET_ACTIVE_WINDOW");
     unsigned char *data = NULL;
     Window root = XDefaultRootWindow(display);
     Window ret;
@@ -263,9 +422,11 @@ get_active_window()
     unsigned long nitems;
     unsigned long bytes_after;
 
-    int status = XGetWindowProperty(display, root, atom, 0, (~0L), 0,
-                                    AnyPropertyType, &actual_type, &actual_format,
-                                    &nitems, &bytes_after, &data);
+    int status;
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_ACTIVE_WINDOW", root,
+          status = XGetWindowProperty(display, root, atom, 0, (~0L), 0,
+                                      AnyPropertyType, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
 
     if(status >= Success && nitems > 0)
         ret = *((Window *)data);
@@ -296,52 +457,192 @@ window_in_active_desktop(Display *display, Window window)
     }
 }
 
-/**
- * @return actual list size
+/** Read part of <code>_NET_CLIENT_LIST_STACKING</code>
+ * @param[in]   offset  first window to read
+ * @param[in]   length  number of windows to read at most
+ * @param[out]  size    number of windows read
+ * @param[out]  total   length of the whole list
+ * @return windows read, to be freed with XFree(), NULL if not available
  */
-int
-list_windows(Display *display, Window root, Window **window_list, uint options)
+static Window *
+read_stacking_list(Display *display, Window root, long offset, long length, int *size, long *total)
 {
     Atom actual_type, atom;
-    int actual_format, /*curr_desktop=42,*/ status = -1, i = 0, actual_size = 0;
-    unsigned long nitems, bytes_after;
+    int actual_format, status = -1;
+    unsigned long nitems = 0, bytes_after = 0;
     unsigned char *data = NULL;
-    Window w;
+
+    atom = get_atom(display, "_NET_CLIENT_LIST_STACKING");
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_CLIENT_LIST_STACKING", root,
+          status = XGetWindowProperty(display, root, atom, offset, length, 0,
+                                      XA_WINDOW, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
+
+    if(status != Success || actual_type != XA_WINDOW || actual_format != 32) {
+        XFree(data);
+        return NULL;
+    }
+
+    *size = nitems;
+    *total = offset + nitems + bytes_after / 4;
+
+    return (Window *) data;
+}
+
+/** Read the whole client list, in stacking order (bottom to top)
+ * @return size of the list, 0 if not available
+ * @note the list is allocated from the action arena, nothing to free
+ */
+int
+get_client_list(Display *display, Window root, Window **window_list)
+{
+    Window *data;
+    int size = 0;
+    long total;
 
     assert(*window_list == NULL);
 
-    //curr_desktop = get_desktop(display, get_active_window(display));
+    if((data = read_stacking_list(display, root, 0, (~0L), &size, &total)) == NULL)
+        return 0;
 
-    atom = XInternAtom(display, "_NET_CLIENT_LIST_STACKING", 0);
-    status = XGetWindowProperty(display, root, atom, 0, (~0L), 0,
-                                XA_WINDOW, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
+    if(size > 0) {
+        *window_list = (Window *) arena_alloc(size * sizeof(Window));
+        memcpy(*window_list, data, size * sizeof(Window));
+        trace_windows(size);
+    }
 
-    if(status >= Success
-            && nitems >= 1
-            && actual_type == XA_WINDOW
-            && actual_format == 32) {
+    XFree(data);
+    return size;
+}
 
-        *window_list = (Window *) malloc(nitems * sizeof(Window));
+/** Evaluate list filters on a window, cheapest first: desktop (cached
+ * for known clients), geometry, then type (cached as well)
+ */
+static bool
+window_matches(Display *display, Window window, uint options, int desktop, int monitor)
+{
+    Client_t *client;
+    bool regular;
 
-        int active_desktop = get_window_desktop(display, get_active_window()); // @todo refactor
-        int active_monitor = get_window_monitor(get_active_window());
+    if(options & LIST_ALL)
+        return true;
 
-        for(i = 0; i < nitems; i++) {
-            w = *((Window *)data + i);
-
-            if((options & LIST_ALL)
-                    || (MATCH((options & LIST_CURR_DESKTOP), active_desktop == get_window_desktop(display, w))
-                        && MATCH((options & LIST_CURR_MONITOR), active_monitor == get_window_monitor(w))
-                        && MATCH((options & LIST_REGULAR)     , is_regular_window(w))
-                        && MATCH((options & LIST_SYSTEM)      , !is_regular_window(w)))) {
-                *((*window_list) + actual_size++) = *((Window *)data + i);      /* warning: ligne poilue ! */
+    if((client = get_client(window)) != NULL && !client->known)
+        client = NULL;
+
+    if((options & LIST_CURR_DESKTOP)
+            && desktop != (client ? client->desktop : get_window_desktop(display, window)))
+        return false;
+
+    if((options & LIST_CURR_MONITOR) && monitor != get_window_monitor(window))
+        return false;
+
+    if(options & (LIST_REGULAR | LIST_SYSTEM)) {
+        regular = client ? (client->regular && !is_ignored(window)) : is_regular_window(window);
+
+        if(((options & LIST_REGULAR) && !regular) || ((options & LIST_SYSTEM) && regular))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Find the k topmost windows matching a filter
+ *
+ * The stacking list is read from its tail by chunks of LIST_CHUNK windows
+ * (or 2k), aiming at the length found by the previous call, and filters
+ * stop being evaluated as soon as k windows match: the cost depends on k
+ * and on the non-matching windows on top, not on the number of clients.
+ *
+ * @param[out]  window_list matching windows, in stacking order (bottom to top)
+ * @param[in]   options     LIST_* filters
+ * @param[in]   k           windows wanted, 0 for all of them
+ * @return actual list size
+ * @note the list is allocated from the action arena, nothing to free
+ */
+int
+list_top_windows(Display *display, Window root, Window **window_list, uint options, int k)
+{
+    /* length of the list at last read, to aim straight at its tail */
+    static long stacking_length = 0;
+
+    Window *data, *matches = NULL, w;
+    long chunk, offset, length, total = 0;
+    int i, size = 0, found = 0, retries = 0, active_desktop = -1, active_monitor = -1;
+    bool tail = true;
+
+    assert(*window_list == NULL);
+
+    /* desktops of windows are unknown with compiz, see get_window_desktop() */
+    if(options & LIST_CURR_DESKTOP)
+        active_desktop = settings.is_compiz ? -1 : get_current_desktop(display);
+    if(options & LIST_CURR_MONITOR)
+        active_monitor = get_window_monitor(get_active_window());
+
+    chunk = (k > 0) ? MAX(2 * k, LIST_CHUNK) : (~0L);
+    offset = (k > 0) ? MAX(0, stacking_length - chunk) : 0;
+    length = chunk;
+
+    for(;;) {
+        if((data = read_stacking_list(display, root, offset, length, &size, &total)) == NULL) {
+            /* list shrank below our guess, start over from its head */
+            if(offset > 0 && retries++ < 2) {
+                stacking_length = offset = 0;
+                continue;
             }
+            break;
         }
+
+        stacking_length = total;
+
+        /* list changed since last time, aim at the tail again */
+        if(tail && offset + size != total && retries++ < 2) {
+            XFree(data);
+            offset = MAX(0, total - chunk);
+            continue;
+        }
+        tail = false;
+
+        if(matches == NULL)
+            matches = (Window *) arena_alloc(((k > 0) ? k : MAX(size, 1)) * sizeof(Window));
+
+        trace_windows(size);
+
+        for(i = size - 1; i >= 0 && (k <= 0 || found < k) && !action_cancelled(); i--) {
+            if(window_matches(display, data[i], options, active_desktop, active_monitor))
+                matches[found++] = data[i];
+        }
+        XFree(data);
+
+        if(offset == 0 || (k > 0 && found >= k) || action_cancelled())
+            break;
+
+        /* previous chunk */
+        length = MIN(offset, chunk);
+        offset -= length;
     }
-  
-      XFree(data);
-      return actual_size;
+
+    /* back to stacking order */
+    for(i = 0; i < found / 2; i++) {
+        w = matches[i];
+        matches[i] = matches[found-1-i];
+        matches[found-1-i] = w;
+    }
+
+    *window_list = matches;
+    return found;
+}
+
+/**
+ * @return actual list size
+ * @note the list is allocated from the action arena, nothing to free
+ * @see list_top_windows
+ */
+int
+list_windows(Display *display, Window root, Window **window_list, uint options)
+{
+    return list_top_windows(display, root, window_list, options, 0);
 }
 
 bool
@@ -353,10 +654,10 @@ is_window_maximized(Display *display, Window window)
 void
 unmaximize_window(Display *display, Window window)
 {
-    Atom state = XInternAtom(display, "_NET_WM_STATE", 0);
-    unsigned long horz = XInternAtom(display, "_NET_WM_STATE_MAXIMIZED_HORZ", 0);
-    unsigned long vert = XInternAtom(display, "_NET_WM_STATE_MAXIMIZED_VERT", 0);
-    unsigned long full = XInternAtom(display, "_NET_WM_STATE_FULLSCREEN", 0);
+    Atom state = get_atom(display, "_NET_WM_STATE");
+    unsigned long horz = get_atom(display, "_NET_WM_STATE_MAXIMIZED_HORZ");
+    unsigned long vert = get_atom(display, "_NET_WM_STATE_MAXIMIZED_VERT");
+    unsigned long full = get_atom(display, "_NET_WM_STATE_FULLSCREEN");
     unsigned long remove = 0;
 
     send_xevent(display, window, state, remove, horz, vert, full, 0);
@@ -365,14 +666,93 @@ unmaximize_window(Display *display, Window window)
 void
 maximize_window(Display *display, Window window)
 {
-    Atom state = XInternAtom(display, "_NET_WM_STATE", 0);
-    unsigned long horz = XInternAtom(display, "_NET_WM_STATE_MAXIMIZED_HORZ", 0);
-    unsigned long vert = XInternAtom(display, "_NET_WM_STATE_MAXIMIZED_VERT", 0);
+    Atom state = get_atom(display, "_NET_WM_STATE");
+    unsigned long horz = get_atom(display, "_NET_WM_STATE_MAXIMIZED_HORZ");
+    unsigned long vert = get_atom(display, "_NET_WM_STATE_MAXIMIZED_VERT");
     unsigned long add = 1;
 
     send_xevent(display, window, state, add, horz, vert, 0, 0);
 }
 
+/** Ask the WM to focus a window, as a pager would
+ * @param current   window active at the time
+ */
+void
+activate_window(Display *display, Window window, Window current)
+{
+    send_xevent(display, window, get_atom(display, "_NET_ACTIVE_WINDOW"),
+                2, CurrentTime, current, 0, 0);
+}
+
+/** Read both parts of <code>WM_CLASS</code>
+ * @param[out] instance, class  empty strings if not available
+ * @return true if the window has a class
+ */
+bool
+get_window_class(Display *display, Window window, char *instance, char *class, int size)
+{
+    XClassHint hint = {NULL, NULL};
+    Status status = 0;
+
+    *instance = *class = '\0';
+
+    XCALL(X_ROUNDTRIP, "GetProperty", "WM_CLASS", window,
+          status = XGetClassHint(display, window, &hint));
+
+    if(status == 0)
+        return false;
+
+    if(hint.res_name != NULL)
+        snprintf(instance, size, "%s", hint.res_name);
+    if(hint.res_class != NULL)
+        snprintf(class, size, "%s", hint.res_class);
+
+    XFree(hint.res_name);
+    XFree(hint.res_class);
+
+    return true;
+}
+
+/** Read a text property (<code>STRING</code> or <code>UTF8_STRING</code>)
+ * such as <code>WM_WINDOW_ROLE</code> or <code>_NET_WM_NAME</code>
+ * @param[out] buffer   truncated to size, empty string if not available
+ * @return true if the property exists
+ */
+bool
+get_window_string(Display *display, Window window, char *property, char *buffer, int size)
+{
+    Atom atom, actual_type;
+    int actual_format, status = -1;
+    unsigned long nitems = 0, bytes_after;
+    unsigned char *data = NULL;
+
+    *buffer = '\0';
+
+    atom = get_atom(display, property);
+    XCALL(X_ROUNDTRIP, "GetProperty", property, window,
+          status = XGetWindowProperty(display, window, atom, 0, size / 4 + 1, 0,
+                                      AnyPropertyType, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
+
+    if(status != Success || actual_format != 8 || data == NULL) {
+        XFree(data);
+        return false;
+    }
+
+    snprintf(buffer, size, "%.*s", (int) nitems, (char *) data);
+    XFree(data);
+
+    return true;
+}
+
+/** Ask the WM to send a window to another desktop */
+void
+set_window_desktop(Display *display, Window window, int desktop)
+{
+    /* source indication 2: pager, acting on behalf of the user */
+    send_xevent(display, window, get_atom(display, "_NET_WM_DESKTOP"), desktop, 2, 0, 0, 0);
+}
+
 /** Build and print a string showing properties of a window
  *
  * The string uses the following format
@@ -388,16 +768,18 @@ maximize_window(Display *display, Window window)
 void
 print_window(Display *display, Window win)
 {
-    char *name, current_desktop_marker = ' ', current_monitor_marker = ' ', regular_win_marker[8];
+    char *name = NULL, current_desktop_marker = ' ', current_monitor_marker = ' ', regular_win_marker[8];
 
     int nitems, monitor_id;
     Geometry_t geometry;
 
-    XFetchName(display, win, &name);
+    XCALL(X_ROUNDTRIP, "GetProperty", "WM_NAME", win,
+          XFetchName(display, win, &name));
     get_window_geometry(display, win, &geometry);
 
     /* get number of properties attached to the window */
-    XListProperties(display, win, &nitems);
+    XCALL(X_ROUNDTRIP, "ListProperties", NULL, win,
+          XFree(XListProperties(display, win, &nitems)));
 
     if(window_in_active_desktop(display, win))
         current_desktop_marker = '*';
@@ -416,6 +798,8 @@ print_window(Display *display, Window win)
            current_desktop_marker, current_monitor_marker, regular_win_marker, (unsigned int)win,
            geometry.x, geometry.y, geometry.width, geometry.height,
            get_window_desktop(display, win) + 1, 4, monitor_id + 1, settings.nb_monitors, name, nitems);
+
+    XFree(name);
 }
 
 void
@@ -438,8 +822,9 @@ send_xevent(Display *display, Window window, Atom message_type,
     e.xclient.data.l[3] = data3;
     e.xclient.data.l[4] = data4;
 
-    XSendEvent(display, DefaultRootWindow(display), False,
-               SubstructureRedirectMask | SubstructureNotifyMask, &e);
+    XCALL(X_ONEWAY, "SendEvent", NULL, window,
+          XSendEvent(display, DefaultRootWindow(display), False,
+                     SubstructureRedirectMask | SubstructureNotifyMask, &e));
 }
 
 void
@@ -447,16 +832,32 @@ move_window(Display *display, Window window, Geometry_t geometry)
 {
     unmaximize_window(display, window);
 
-    XMoveWindow(display, window, geometry.x, geometry.y);
+    XCALL(X_ONEWAY, "ConfigureWindow", NULL, window,
+          XMoveWindow(display, window, geometry.x, geometry.y));
 }
 
 void
 move_resize_window(Display *display, Window window, Geometry_t geometry)
 {
-    unmaximize_window(display, window);
+    Client_t *client = get_client(window);
+    const unsigned int maximized = (1 << STATE_MAXIMIZED_VERT) | (1 << STATE_MAXIMIZED_HORZ)
+                                   | (1 << STATE_FULLSCREEN);
+
+    /* states of known clients are kept up to date, see drain_client_events() */
+    if(client == NULL || !client->known || (client->states & maximized))
+        unmaximize_window(display, window);
+
+    if(supports_moveresize) {
+        /* north-west gravity, x, y, width and height given, source: pager */
+        send_xevent(display, window, get_atom(display, "_NET_MOVERESIZE_WINDOW"),
+                    NorthWestGravity | (0xf << 8) | (2 << 12),
+                    geometry.x, geometry.y, geometry.width, geometry.height);
+        return;
+    }
 
-    XMoveResizeWindow(display, window, geometry.x, geometry.y,
-                      geometry.width, geometry.height);
+    XCALL(X_ONEWAY, "ConfigureWindow", NULL, window,
+          XMoveResizeWindow(display, window, geometry.x, geometry.y,
+                            geometry.width, geometry.height));
 }
 
 void
@@ -466,9 +867,11 @@ get_window_geometry(Display *display, Window window, Geometry_t *geometry)
     Window retwin;
     int x, y;
 
-    XGetWindowAttributes(display, window, &attributes);
+    XCALL(X_ROUNDTRIP, "GetWindowAttributes", NULL, window,
+          XGetWindowAttributes(display, window, &attributes));
 
-    XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &retwin);
+    XCALL(X_ROUNDTRIP, "TranslateCoordinates", NULL, window,
+          XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &retwin));
 
     D(("Window is at (%d, %d), size (%d, %d), border %d",
        x, y,
@@ -491,9 +894,11 @@ get_window_relative_geometry(Display *display, Window window, Geometry_t *geomet
     int x, y;
     int i = get_window_monitor(window);
 
-    XGetWindowAttributes(display, window, &attributes);
+    XCALL(X_ROUNDTRIP, "GetWindowAttributes", NULL, window,
+          XGetWindowAttributes(display, window, &attributes));
 
-    XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &retwin);
+    XCALL(X_ROUNDTRIP, "TranslateCoordinates", NULL, window,
+          XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &retwin));
 
     if(geometry != NULL) {
         geometry->x = x - settings.monitors[i].workarea.x;
@@ -514,10 +919,12 @@ get_window_frame_extent(Display *display, Window window,
     unsigned long bytes_after;
     unsigned char *data;
 
-    Atom atom = XInternAtom(display, "_NET_FRAME_EXTENTS", 0);
-    int status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
-                                    XA_CARDINAL, &actual_type, &actual_format,
-                                    &nitems, &bytes_after, &data);
+    Atom atom = get_atom(display, "_NET_FRAME_EXTENTS");
+    int status;
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_FRAME_EXTENTS", window,
+          status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
     if(status >= Success
             && nitems >= 4
             && actual_type == XA_CARDINAL
@@ -552,10 +959,12 @@ get_workarea(Display *display, Window window,
     unsigned long bytes_after;
     unsigned char *data;
 
-    Atom atom = XInternAtom(display, "_NET_WORKAREA", 0);
-    int status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
-                                    XA_CARDINAL, &actual_type, &actual_format,
-                                    &nitems, &bytes_after, &data);
+    Atom atom = get_atom(display, "_NET_WORKAREA");
+    int status;
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_WORKAREA", window,
+          status = XGetWindowProperty(display, window, atom, 0, (~0L), 0,
+                                      XA_CARDINAL, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
     if(status >= Success
             && nitems >= 4
             && actual_type == XA_CARDINAL
@@ -586,6 +995,8 @@ get_workarea(Display *display, Window window,
 void
 fill_geometry(Display *display, Window window, Geometry_t geometry)
 {
+    Client_t *client;
+
 #if 0
     int right, left, top, bottom;
 
@@ -612,9 +1023,189 @@ fill_geometry(Display *display, Window window, Geometry_t geometry)
         D(("\t=> (%d, %d), (%d, %d) [compiz]", geometry.x, geometry.y, geometry.width, geometry.height));
     }
 #endif
+    client = add_client(window);
+    client->seen = geometry;
+    invalidate_neighbours();
+
+    geometry = correct_geometry(display, client, geometry);
     move_resize_window(display, window, geometry);
 }
 
+/** Desktop currently displayed
+ * Unlike get_active_desktop(), does not depend on a window having the focus.
+ */
+int
+get_current_desktop(Display *display)
+{
+    if(settings.is_compiz)
+        return __compiz_get_active_desktop();
+    else
+        return get_int_property(display, XDefaultRootWindow(display), "_NET_CURRENT_DESKTOP");
+}
+
+/** Number of desktops (<code>_NET_NUMBER_OF_DESKTOPS</code>) */
+int
+get_nb_desktop(Display *display)
+{
+    return get_int_property(display, XDefaultRootWindow(display), "_NET_NUMBER_OF_DESKTOPS");
+}
+
+/**
+ * Select the events of a client the worker follows, once
+ * @see drain_client_events
+ */
+void
+watch_client(Display *display, Client_t *client)
+{
+    if(client->watched)
+        return;
+
+    XCALL(X_ONEWAY, "ChangeWindowAttributes", "WORKER_EVENT_MASK", client->window,
+          XSelectInput(display, client->window, WORKER_EVENT_MASK));
+    client->watched = true;
+}
+
+/**
+ * Forget cached properties of the clients whose desktop, types, states or
+ * size hints changed since the last action, they are fetched again when
+ * needed, learn from the geometry windows ended at (see @ref Corrections),
+ * follow the windows moved by hand (see @ref Neighbours) and forget the
+ * ones destroyed.
+ * Only reads events already sent to the worker's connection: no round trip.
+ * @see update_client
+ */
+void
+drain_client_events(Display *display)
+{
+    static Atom desktop = None, types, states;
+    Client_t *client;
+    XEvent event;
+
+    if(desktop == None) {
+        desktop = get_atom(display, "_NET_WM_DESKTOP");
+        types = get_atom(display, "_NET_WM_WINDOW_TYPE");
+        states = get_atom(display, "_NET_WM_STATE");
+    }
+
+    while(XPending(display)) {
+        XNextEvent(display, &event);
+
+        if(event.type == ConfigureNotify) {
+            learn_correction(&event.xconfigure);
+            track_configure(&event.xconfigure);
+        } else if(event.type == DestroyNotify) {
+            forget_client(event.xdestroywindow.window);
+        }
+        if(event.type != PropertyNotify || (client = get_client(event.xproperty.window)) == NULL)
+            continue;
+
+        if(event.xproperty.atom == XA_WM_NORMAL_HINTS)
+            client->hints_known = false;
+        else if(event.xproperty.atom == desktop || event.xproperty.atom == types
+                || event.xproperty.atom == states) {
+            client->known = false;
+            invalidate_neighbours();
+        }
+    }
+
+    save_corrections();
+}
+
+/** Size hints of a client, fetched the first time only (and again once
+ * they changed, see drain_client_events())
+ * @see solve_hints
+ */
+const SizeHints_t *
+get_client_hints(Display *display, Client_t *client)
+{
+    XSizeHints hints;
+    long supplied;
+    Status status = 0;
+
+    if(client->hints_known)
+        return &client->hints;
+
+    watch_client(display, client);
+    XCALL(X_ROUNDTRIP, "GetProperty", "WM_NORMAL_HINTS", client->window,
+          status = XGetWMNormalHints(display, client->window, &hints, &supplied));
+
+    memset(&client->hints, 0, sizeof(SizeHints_t));
+    if(status) {
+        if(hints.flags & PResizeInc) {
+            client->hints.inc[0] = hints.width_inc;
+            client->hints.inc[1] = hints.height_inc;
+        }
+
+        /* base and minimum sizes stand for each other (ICCCM 4.1.2.3) */
+        if(hints.flags & PBaseSize) {
+            client->hints.base[0] = hints.base_width;
+            client->hints.base[1] = hints.base_height;
+        } else if(hints.flags & PMinSize) {
+            client->hints.base[0] = hints.min_width;
+            client->hints.base[1] = hints.min_height;
+        }
+
+        if(hints.flags & PMinSize) {
+            client->hints.min[0] = hints.min_width;
+            client->hints.min[1] = hints.min_height;
+        } else if(hints.flags & PBaseSize) {
+            client->hints.min[0] = hints.base_width;
+            client->hints.min[1] = hints.base_height;
+        }
+    }
+    client->hints_known = true;
+
+    return &client->hints;
+}
+
+/** Client record of a window, with its desktop, type and monitor fetched
+ * the first time only
+ * @see Client_t
+ */
+Client_t *
+update_client(Display *display, Window window)
+{
+    Client_t *client = add_client(window);
+    ClientState_t *state;
+
+    if(client->known)
+        return client;
+
+    /* told when they change, see drain_client_events() */
+    watch_client(display, client);
+
+    client->desktop = get_window_desktop(display, window);
+    client->types = get_window_types(display, window);
+    client->states = get_window_states(display, window);
+    client->regular = is_regular(client->types, client->states);
+    if(client->monitor < 0 && (state = get_state(window)) != NULL)
+        client->monitor = state->monitor;
+    if(client->monitor < 0)
+        client->monitor = get_window_monitor(window);
+    client->known = true;
+
+    return client;
+}
+
+/** Move a batch of windows
+ * Requests are only flushed once, by the caller, unless resizes are paced.
+ * @return number of windows sent, the first ones, fewer if superseded
+ * @see pace_geometries
+ */
+int
+fill_geometries(Display *display, const Window *windows, const Geometry_t *geometries, int size)
+{
+    int i;
+
+    if(settings.pace != PACE_OFF)
+        return pace_geometries(display, windows, geometries, size);
+
+    for(i = 0; i < size && !action_cancelled(); i++)
+        fill_geometry(display, windows[i], geometries[i]);
+
+    return i;
+}
+
 /** Find which desktop a specific window belongs to
  * @return  Id of the desktop where the window has been found, defaults to 0 otherwise
  */
@@ -640,10 +1231,20 @@ get_window_monitor(const Window window)
         return 0;
 
     /* general case */
-    int i = 0;
     Geometry_t w;
     get_window_geometry(display, window, &w);
 
+    return get_geometry_monitor(w);
+}
+
+/** Find which monitor a geometry (its top-left corner) belongs to
+ * @return  Id of the monitor, defaults to 0 if out of every monitor
+ */
+int
+get_geometry_monitor(Geometry_t w)
+{
+    int i = 0;
+
     for(i = 0; i < settings.nb_monitors; i++) {
         if((w.x >= settings.monitors[i].infos.x && w.x < settings.monitors[i].infos.x + settings.monitors[i].infos.width)
                 && (w.y >= settings.monitors[i].infos.y && w.y < settings.monitors[i].infos.y + settings.monitors[i].infos.height))
@@ -683,12 +1284,39 @@ check_compiz_wm()
     unsigned long nitems, bytes_after;
     unsigned char *data = NULL;
 
-    atom = XInternAtom(display, "_COMPIZ_SUPPORTING_DM_CHECK", 0);
-    status = XGetWindowProperty(display, root, atom, 0, (~0L), 0,
-                                AnyPropertyType, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &data);
+    atom = get_atom(display, "_COMPIZ_SUPPORTING_DM_CHECK");
+    XCALL(X_ROUNDTRIP, "GetProperty", "_COMPIZ_SUPPORTING_DM_CHECK", root,
+          status = XGetWindowProperty(display, root, atom, 0, (~0L), 0,
+                                      AnyPropertyType, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
 
     settings.is_compiz = (status == Success && nitems >= 1);
     XFree(data);
 }
 
+/**
+ * Find out once which optional EWMH messages the WM handles, from the
+ * <code>_NET_SUPPORTED</code> list of the root window
+ */
+void
+check_wm_support()
+{
+    Atom actual_type, moveresize;
+    int actual_format, status = -1;
+    unsigned long nitems = 0, bytes_after, i;
+    unsigned char *data = NULL;
+
+    moveresize = get_atom(display, "_NET_MOVERESIZE_WINDOW");
+    XCALL(X_ROUNDTRIP, "GetProperty", "_NET_SUPPORTED", root,
+          status = XGetWindowProperty(display, root, get_atom(display, "_NET_SUPPORTED"), 0, (~0L), 0,
+                                      XA_ATOM, &actual_type, &actual_format,
+                                      &nitems, &bytes_after, &data));
+
+    if(status == Success && actual_type == XA_ATOM && actual_format == 32) {
+        for(i = 0; i < nitems; i++)
+            supports_moveresize |= (((Atom *) data)[i] == moveresize);
+    }
+    XFree(data);
+
+    D(("_NET_MOVERESIZE_WINDOW %ssupported", supports_moveresize ? "" : "not "));
+}
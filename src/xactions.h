@@ -21,6 +21,7 @@
 #include <X11/Xlib.h>
 #include "tiler.h"
 #include "utils.h"
+#include "clients.h"
 
 /* windows list filters */
 #define LIST_ALL            (0x01 << 0) // all windows are included
@@ -30,26 +31,82 @@
 #define LIST_SYSTEM         (0x01 << 4) // !LIST_REGULAR
 #define LIST_DEFAULT        LIST_REGULAR | LIST_CURR_MONITOR | LIST_CURR_DESKTOP
 
+/* events the worker selects on client windows, see drain_client_events() */
+#define WORKER_EVENT_MASK   (PropertyChangeMask | StructureNotifyMask)
 
+/* windows read at once from the stacking list by top-k queries */
+#define LIST_CHUNK          16
+
+
+/** EWMH window types @see get_window_types */
+typedef enum {
+    WINDOW_DESKTOP,
+    WINDOW_DOCK,
+    WINDOW_TOOLBAR,
+    WINDOW_MENU,
+    WINDOW_UTILITY,
+    WINDOW_SPLASH,
+    WINDOW_DIALOG,
+    WINDOW_NORMAL,
+    NB_WINDOW_TYPES
+} WindowType_t;
+
+/** EWMH window states @see get_window_states */
+typedef enum {
+    STATE_MODAL,
+    STATE_STICKY,
+    STATE_MAXIMIZED_VERT,
+    STATE_MAXIMIZED_HORZ,
+    STATE_SHADED,
+    STATE_SKIP_TASKBAR,
+    STATE_SKIP_PAGER,
+    STATE_HIDDEN,
+    STATE_FULLSCREEN,
+    STATE_ABOVE,
+    STATE_BELOW,
+    STATE_DEMANDS_ATTENTION,
+    NB_WINDOW_STATES
+} WindowState_t;
+
+extern const char * const window_type_names[NB_WINDOW_TYPES];
+extern const char * const window_state_names[NB_WINDOW_STATES];
+
+Atom get_atom(Display *, const char *);
 
 Window get_active_window();
+Window get_display_active_window(Display *);
 int get_active_desktop();
+int get_current_desktop(Display *);
 bool window_in_active_desktop(Display *, Window);
+int get_client_list(Display *, Window, Window **);
 int list_windows(Display*, Window, Window **, uint);
+int list_top_windows(Display *, Window, Window **, uint, int);
+Client_t *update_client(Display *, Window);
+const SizeHints_t *get_client_hints(Display *, Client_t *);
 
 void unmaximize_window(Display *, Window);
 void maximize_window(Display *, Window);
+void activate_window(Display *, Window, Window);
 
 int get_nb_desktop(Display *);
 int get_nb_screens(Display *);
 void get_workarea(Display *, Window, int *, int *, int *, int *);
 
 int  get_window_monitor(const Window);
+int  get_geometry_monitor(Geometry_t);
 int  get_window_desktop(Display *, Window);
 void get_window_geometry(Display *, Window, Geometry_t *);
 void get_window_relative_geometry(Display *, Window, Geometry_t *);
 void get_window_frame_extent(Display *, Window, int *, int *, int *, int *);
 bool is_window_maximized(Display *, Window);
+unsigned int get_window_types(Display *, Window);
+unsigned int get_window_states(Display *, Window);
+void set_window_types(Display *, Window, unsigned int);
+void set_window_states(Display *, Window, unsigned int);
+bool is_regular(unsigned int, unsigned int);
+bool get_window_class(Display *, Window, char *, char *, int);
+bool get_window_string(Display *, Window, char *, char *, int);
+void set_window_desktop(Display *, Window, int);
 
 void print_window(Display *, Window);
 
@@ -57,6 +114,11 @@ void send_xevent(Display *, Window, Atom, unsigned long, unsigned long, unsigned
 void move_window(Display *, Window, Geometry_t);
 void move_resize_window(Display *, Window, Geometry_t);
 void fill_geometry(Display *, Window, Geometry_t);
+int fill_geometries(Display *, const Window *, const Geometry_t *, int);
+
+void watch_client(Display *, Client_t *);
+void drain_client_events(Display *);
+void check_wm_support();
 
 /* compiz */
 void check_compiz_wm();